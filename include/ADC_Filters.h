@@ -0,0 +1,328 @@
+////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Filter policies for SmoothedADC. Each one is a plain struct whose storage is sized at
+// compile time, so a control only pays for the window it actually uses.
+//
+// Every policy provides:
+//  reset: forget all history
+//  push:  add one raw sample
+//  value: current filtered output (only meaningful once at least one sample was pushed)
+//  full:  true once the filter has seen enough samples to be fully settled
+//
+#pragma once
+
+#include <Arduino.h>
+#include <array>
+#include <type_traits>
+
+////////////////////////////////////////////////////////////////////////////////////////////
+// Moving average over the last N samples. Until the window fills up, it averages whatever
+// it has. When N is a power of two, the full-window divide compiles down to a shift.
+template <uint16_t N>
+struct BoxcarFilter
+{
+  static_assert(N > 0, "BoxcarFilter needs a window of at least one sample");
+
+  typedef std::conditional_t<(N < 256), uint8_t, uint16_t> index_t;
+
+  static constexpr bool IS_POW2 = ((N & (N - 1)) == 0);
+
+  static constexpr uint8_t log2(uint16_t n)
+  {
+    return (n <= 1) ? 0 : 1 + log2(n >> 1);
+  }
+
+  std::array<uint16_t, N> readings;
+  uint32_t runningSum;
+  index_t  writeIndex;
+  index_t  sampleCount;
+
+  void reset()
+  {
+    readings.fill(0);
+    runningSum  = 0;
+    writeIndex  = 0;
+    sampleCount = 0;
+  }
+
+  void push(uint16_t sample)
+  {
+    runningSum += sample;
+    if (full())
+    {
+      runningSum -= readings[writeIndex];
+    }
+    else
+    {
+      ++sampleCount;
+    }
+
+    readings[writeIndex] = sample;
+    ++writeIndex;
+    if (writeIndex == N)
+    {
+      writeIndex = 0;
+    }
+  }
+
+  uint16_t value() const
+  {
+    if (sampleCount == 0)
+    {
+      return 0;
+    }
+
+    if constexpr (IS_POW2)
+    {
+      if (full())
+      {
+        return (uint16_t)(runningSum >> log2(N));
+      }
+    }
+
+    return (uint16_t)(runningSum / sampleCount);
+  }
+
+  bool full() const { return sampleCount == N; }
+};
+
+// Boxcar of 2^Log2N samples, e.g. Pow2BoxcarFilter<4> averages 16 samples with a shift
+template <uint8_t Log2N>
+using Pow2BoxcarFilter = BoxcarFilter<(uint16_t)(1 << Log2N)>;
+
+
+////////////////////////////////////////////////////////////////////////////////////////////
+// One-pole integer EMA: y += (x - y) / 2^Shift. Four bytes of state no matter how heavy the
+// smoothing; Shift = 5 settles about as fast as a 100-sample boxcar.
+template <uint8_t Shift>
+struct EmaFilter
+{
+  static_assert(Shift < 16, "EmaFilter shift must leave room for 16-bit samples");
+
+  uint32_t accumulator;   // Filtered value << Shift
+  uint16_t sampleCount;   // Saturates at 2^Shift
+
+  void reset()
+  {
+    accumulator = 0;
+    sampleCount = 0;
+  }
+
+  void push(uint16_t sample)
+  {
+    if (sampleCount == 0)
+    {
+      // Start from the first reading instead of ramping up from zero
+      accumulator = (uint32_t)sample << Shift;
+    }
+    else
+    {
+      accumulator = accumulator - (accumulator >> Shift) + sample;
+    }
+
+    if (!full())
+    {
+      ++sampleCount;
+    }
+  }
+
+  uint16_t value() const { return (uint16_t)(accumulator >> Shift); }
+  bool     full()  const { return sampleCount >= ((uint16_t)1 << Shift); }
+};
+
+
+////////////////////////////////////////////////////////////////////////////////////////////
+// Adaptive low-pass in the spirit of the 1-Euro filter: the cutoff rises with the estimated
+// rate of change, so a resting fader gets heavy smoothing and a moving one gets almost no
+// lag. Integer math only.
+//
+//  MinAlpha:   smoothing at rest, as a Q16 fraction of the error taken per sample
+//              (1024 ~= EmaFilter<6>; at least 16)
+//  Beta:       how far the cutoff opens per unit of speed; with the default, the filter is
+//              wide open once the fader moves ~8 counts per sample
+//  SpeedShift: smoothing applied to the speed estimate itself (EMA shift)
+template <uint16_t MinAlpha = 1024, uint16_t Beta = 32, uint8_t SpeedShift = 3>
+struct AdaptiveFilter
+{
+  // full() waits about 1 / alpha samples, and FilteredADC::fillBuffer() spins until then
+  static_assert(MinAlpha >= 16, "AdaptiveFilter resting alpha below 16 would take over 4096 samples to settle");
+
+  static constexpr uint8_t  FRAC_BITS = 8;
+  static constexpr uint32_t ALPHA_ONE = (uint32_t)1 << 16;
+  static constexpr uint32_t SETTLED   = ALPHA_ONE / MinAlpha;
+
+  int32_t  estimate;      // Filtered value << FRAC_BITS
+  int32_t  speed;         // Smoothed tracking error (same units), sign = direction
+  uint32_t sampleCount;   // Saturates at SETTLED
+
+  void reset()
+  {
+    estimate    = 0;
+    speed       = 0;
+    sampleCount = 0;
+  }
+
+  void push(uint16_t sample)
+  {
+    int32_t target((int32_t)sample << FRAC_BITS);
+    if (sampleCount == 0)
+    {
+      estimate    = target;
+      speed       = 0;
+      sampleCount = 1;
+      return;
+    }
+
+    // A moving input drags the estimate behind it; the size of that lag is our speed
+    int32_t error(target - estimate);
+    speed += (error - speed) / ((int32_t)1 << SpeedShift);
+
+    uint32_t alpha((uint32_t)MinAlpha + (uint32_t)abs(speed) * Beta);
+    if (alpha > ALPHA_ONE)
+    {
+      alpha = ALPHA_ONE;
+    }
+
+    estimate += (int32_t)(((int64_t)error * alpha) >> 16);
+
+    if (!full())
+    {
+      ++sampleCount;
+    }
+  }
+
+  uint16_t value() const
+  {
+    return (estimate <= 0) ? 0 : (uint16_t)((estimate + (1 << (FRAC_BITS - 1))) >> FRAC_BITS);
+  }
+
+  bool full() const { return sampleCount >= SETTLED; }
+};
+
+
+////////////////////////////////////////////////////////////////////////////////////////////
+// Sliding median over the last N samples, for knocking out single-sample spikes (DAC and
+// shift-register switching noise) rather than smearing them out like an average would.
+// The window is kept sorted as it slides: the outgoing sample's slot is reused for the
+// incoming one and walked into place, so each sample costs at most N small-integer moves
+// and no sort.
+template <uint8_t N>
+struct MedianFilter
+{
+  static_assert((N & 1) && (N > 1), "MedianFilter window must be odd and at least 3");
+
+  std::array<uint16_t, N> history;   // Arrival order
+  std::array<uint16_t, N> sorted;    // Same samples, ascending
+  uint8_t writeIndex;
+  uint8_t sampleCount;
+
+  void reset()
+  {
+    writeIndex  = 0;
+    sampleCount = 0;
+  }
+
+  void push(uint16_t sample)
+  {
+    uint8_t pos;
+    if (sampleCount < N)
+    {
+      // Still filling: open a slot at the end
+      pos = sampleCount;
+      ++sampleCount;
+    }
+    else
+    {
+      // Binary search for the sample that's about to fall out of the window
+      uint16_t outgoing(history[writeIndex]);
+      uint8_t lo(0);
+      uint8_t hi(N - 1);
+      while (lo < hi)
+      {
+        uint8_t mid((lo + hi) >> 1);
+        if (sorted[mid] < outgoing)
+        {
+          lo = mid + 1;
+        }
+        else
+        {
+          hi = mid;
+        }
+      }
+      pos = lo;
+    }
+
+    // Walk the free slot to wherever the new sample belongs
+    while ((pos + 1 < sampleCount) && (sorted[pos + 1] < sample))
+    {
+      sorted[pos] = sorted[pos + 1];
+      ++pos;
+    }
+    while ((pos > 0) && (sorted[pos - 1] > sample))
+    {
+      sorted[pos] = sorted[pos - 1];
+      --pos;
+    }
+    sorted[pos] = sample;
+
+    history[writeIndex] = sample;
+    ++writeIndex;
+    if (writeIndex == N)
+    {
+      writeIndex = 0;
+    }
+  }
+
+  uint16_t value() const { return (sampleCount == 0) ? 0 : sorted[sampleCount >> 1]; }
+  bool     full()  const { return sampleCount == N; }
+};
+
+
+////////////////////////////////////////////////////////////////////////////////////////////
+// Runs two policies back to back, e.g. FilterChain<MedianFilter<5>, EmaFilter<5>> rejects
+// spikes and then smooths what's left, all in a single SmoothedADC
+template <typename First, typename Second>
+struct FilterChain
+{
+  First  first;
+  Second second;
+
+  void reset()
+  {
+    first.reset();
+    second.reset();
+  }
+
+  void push(uint16_t sample)
+  {
+    first.push(sample);
+    second.push(first.value());
+  }
+
+  uint16_t value() const { return second.value(); }
+  bool     full()  const { return first.full() && second.full(); }
+};
+
+
+////////////////////////////////////////////////////////////////////////////////////////////
+// Pass-through: the output is the latest sample
+struct NoFilter
+{
+  uint16_t latest;
+  bool     primed;
+
+  void reset()
+  {
+    latest = 0;
+    primed = false;
+  }
+
+  void push(uint16_t sample)
+  {
+    latest = sample;
+    primed = true;
+  }
+
+  uint16_t value() const { return latest; }
+  bool     full()  const { return primed; }
+};
@@ -7,6 +7,8 @@
 #include <Arduino.h>
 #include "MCP_ADC.h"
 #include "ESP32AnalogRead.h"
+#include <ADC_Filters.h>
+#include <atomic>
 #include <memory>
 #include <list>
 #include <freertos/semphr.h>
@@ -70,10 +72,99 @@ public:
 };
 
 
+////////////////////////////////////////////////////////////////////////////////////////////
+// Owns an MCP ADC and reads every registered channel back-to-back in a single pass, so a
+// bank of faders costs one burst (and one mutex round-trip) per tick instead of one per
+// channel. MCP_Channels built on a frame just index into it; call service() here once per
+// tick *before* servicing the channels themselves.
+//
+//  inADC: the MCP_ADC to scan, e.g. MCP3008, MCP3204, etc.
+class MCP_ScanFrame
+{
+public:
+
+  inline static const uint8_t MAX_CHANNELS = 8;
+
+private:
+
+  SemaphoreHandle_t mutex;
+  std::shared_ptr<MCP_ADC> pADC;
+
+  uint8_t channelMask;
+  // Stored before frameCount is bumped (release), so anyone who sees a count (acquire) sees
+  // at least that frame's samples
+  std::array<std::atomic<uint16_t>, MAX_CHANNELS> frame;
+  std::atomic<uint32_t> frameCount;
+
+  static inline const TickType_t PATIENCE = 10;
+
+public:
+
+  MCP_ScanFrame(std::shared_ptr<MCP_ADC>inADC):
+      mutex(xSemaphoreCreateRecursiveMutex()),
+      pADC(inADC),
+      channelMask(0),
+      frameCount(0)
+  {
+    for (auto &sample : frame)
+    {
+      sample.store(0, std::memory_order_relaxed);
+    }
+  }
+
+  // Include a channel in the scan
+  void addChannel(uint8_t channel)
+  {
+    if (channel < MAX_CHANNELS)
+    {
+      channelMask |= (uint8_t)(1 << channel);
+    }
+  }
+
+  // Convert every registered channel and publish the results as one frame
+  void service(void)
+  {
+    if (pADC == nullptr)
+    {
+      return;
+    }
+
+    // Someone else is mid-scan; their frame will do
+    if (pdTRUE != xSemaphoreTakeRecursive(mutex, PATIENCE))
+    {
+      return;
+    }
+
+    for (uint8_t ch(0); ch < MAX_CHANNELS; ++ch)
+    {
+      if (channelMask & (1 << ch))
+      {
+        frame[ch].store(pADC->analogRead(ch), std::memory_order_relaxed);
+      }
+    }
+    frameCount.fetch_add(1, std::memory_order_release);
+    xSemaphoreGiveRecursive(mutex);
+  }
+
+  // Latest conversion for [channel]
+  uint16_t read(uint8_t channel)
+  {
+    return (channel < MAX_CHANNELS) ? frame[channel].load(std::memory_order_relaxed) : 0;
+  }
+
+  // Number of completed scans; handy for checking a frame is fresh. Reads after this one
+  // see that frame or a newer one.
+  uint32_t getFrameCount(void)          { return frameCount.load(std::memory_order_acquire); }
+  std::shared_ptr<MCP_ADC> getADC(void) { return pADC; }
+};
+
+
 ////////////////////////////////////////////////////////////////////////////////////////////
 // ADC Channel corresponding to an MCP ADC
 //
 //  *inADC:    pointer to an instance of an MCP_ADC, e.g. MCP3008, MCP3204, etc.
+//  inFrame:   alternatively, a shared MCP_ScanFrame; the channel then reads from the frame
+//             and never touches the ADC itself
 //  inChannel: which ADC channel to read from
 class MCP_Channel : public ADC_Object
 {
@@ -81,63 +172,80 @@ private:
 
   uint8_t channel;
   std::shared_ptr<MCP_ADC> pADC;
-  volatile uint16_t rawVal;
+  std::shared_ptr<MCP_ScanFrame> pFrame;
+  std::atomic<uint16_t> rawVal;
 
 public:
 
   virtual void service(void) override
   {
-    if (pdTRUE != lock())
+    // Sampling is the frame's job
+    if (pFrame != nullptr)
     {
-      Serial.println("MCH svc semtake failed");
-      while (1);
+      return;
     }
 
     if ( (pADC == nullptr) || (channel == INVALID_CHANNEL) )
     {
-      rawVal = adcMin;
+      rawVal.store(adcMin, std::memory_order_release);
     }
     else
     {
-      rawVal = pADC->analogRead(channel);
+      rawVal.store(pADC->analogRead(channel), std::memory_order_release);
     }
-    unlock();
   }
 
   MCP_Channel():
       channel(99),
-      pADC(nullptr)
+      pADC(nullptr),
+      rawVal(0)
   { ; }
 
   MCP_Channel(MCP_ADC *pADC,
               uint8_t inChannel = INVALID_CHANNEL):
       pADC(std::shared_ptr<MCP_ADC>(pADC)),
-      channel(inChannel)
+      channel(inChannel),
+      rawVal(0)
   { ; }
 
   MCP_Channel(std::shared_ptr<MCP_ADC>pADC,
               uint8_t inChannel = INVALID_CHANNEL):
       pADC(pADC),
-      channel(inChannel)
+      channel(inChannel),
+      rawVal(0)
   { ; }
 
+  MCP_Channel(std::shared_ptr<MCP_ScanFrame>inFrame,
+              uint8_t inChannel = INVALID_CHANNEL):
+      pADC(inFrame->getADC()),
+      pFrame(inFrame),
+      channel(inChannel),
+      rawVal(0)
+  {
+    pFrame->addChannel(channel);
+  }
+
   void setADC(MCP_ADC *pADC) { this->pADC = std::shared_ptr<MCP_ADC>(pADC); }
-  void setChannel(uint8_t inChannel)    { channel = inChannel; }
+  void setChannel(uint8_t inChannel)
+  {
+    channel = inChannel;
+    if (pFrame != nullptr)
+    {
+      pFrame->addChannel(channel);
+    }
+  }
 
   std::shared_ptr<MCP_ADC> getADC(void) { return pADC; }
   uint8_t getChannel(void)              { return channel; }
 
   virtual uint16_t read(void) override
   {
-    if (pdTRUE != lock())
+    if (pFrame != nullptr)
     {
-      Serial.println("MCH read semtake failed");
-      while (1);
+      return (channel == INVALID_CHANNEL) ? adcMin : pFrame->read(channel);
     }
 
-    uint16_t ret = rawVal;
-    unlock();
-    return ret;
+    return rawVal.load(std::memory_order_acquire);
   }
 };
 
@@ -153,7 +261,7 @@ private:
   ESP32AnalogRead ADC;
   uint8_t pin;
 
-  volatile uint16_t rawVal;
+  std::atomic<uint16_t> rawVal;
 
 public:
   ESP32_ADC_Channel():
@@ -163,43 +271,28 @@ public:
   }
 
   ESP32_ADC_Channel(uint8_t inPin):
-      ADC_Object()
+      ADC_Object(),
+      rawVal(0)
   {
     ADC = ESP32AnalogRead();
-    rawVal = 0;
     this->attach(inPin);
   }
 
   virtual void service() override
   {
-    if (pdTRUE != lock())
-    {
-      Serial.println("e32 svc semtake failed");
-      while (1);
-    }
-
     if (pin == INVALID_CHANNEL)
     {
-      rawVal = adcMin;
+      rawVal.store(adcMin, std::memory_order_release);
     }
     else
     {
-      rawVal = ADC.readRaw();
+      rawVal.store(ADC.readRaw(), std::memory_order_release);
     }
-    unlock();
   }
 
   virtual uint16_t read() override
   {
-    if (pdTRUE != lock())
-    {
-      Serial.println("e32 read semtake failed");
-      while (1);
-    }
-
-    uint16_t ret = rawVal;
-    unlock();
-    return ret;
+    return rawVal.load(std::memory_order_acquire);
   }
 
   void attach(uint8_t inChannel)
@@ -215,126 +308,112 @@ public:
 };
 
 
-class SmoothedADC : public ADC_Object
+////////////////////////////////////////////////////////////////////////////////////////////
+// Smoothing wrapper around another ADC_Object; the filtering itself is supplied by
+// SmoothedADC<Filter> below. This base is what controls hold on to, so they don't need to
+// know which filter they've been given.
+//
+// service() is the only writer: the filter state is private to it and only the finished
+// output is published (atomically), so read() never blocks the service task or vice versa.
+// reset() may be called from any task; it's applied at the start of the next service().
+class FilteredADC : public ADC_Object
 {
 protected:
-  std::array<volatile uint16_t, MAX_BUFFER_SIZE> readings;
+  static inline const int32_t NOTHING_PUBLISHED = -1;
+
   std::shared_ptr<ADC_Object> pADC;
+  std::atomic<int32_t>        published;
+  std::atomic<bool>           resetPending;
 
-  uint8_t   buffSize;
-  volatile uint8_t   writeIndex;
-  volatile int64_t   runningSum;
-  volatile uint16_t  sampleCount;
+  FilteredADC(std::shared_ptr<ADC_Object>inADC):
+      pADC(inADC),
+      published(NOTHING_PUBLISHED),
+      resetPending(false)
+  { ; }
 
 public:
-  SmoothedADC(std::shared_ptr<ADC_Object>inADC,
-              uint8_t buffSize = MAX_BUFFER_SIZE):
-      buffSize(buffSize),
-      pADC(inADC)
-  {
-    reset();
-  }
 
-  SmoothedADC(ESP32_ADC_Channel *inADC,
-              uint8_t buffSize = MAX_BUFFER_SIZE):
-      buffSize(buffSize)
-  {
-    pADC = std::shared_ptr<ESP32_ADC_Channel>(inADC);
-    reset();
-  }
+  // True once the filter has seen enough samples to be fully settled
+  virtual bool isFull(void) = 0;
 
-  SmoothedADC(std::shared_ptr<ESP32_ADC_Channel>inADC,
-              uint8_t buffSize = MAX_BUFFER_SIZE):
-      buffSize(buffSize),
-      pADC(inADC)
+  void reset()
   {
-    reset();
+    resetPending.store(true, std::memory_order_release);
   }
 
-  SmoothedADC(MCP_Channel *inADC,
-              uint8_t buffSize = MAX_BUFFER_SIZE):
-      buffSize(buffSize)
+  virtual uint16_t read(void) override
   {
-    pADC = std::shared_ptr<MCP_Channel>(inADC);
-    reset();
-  }
+    int32_t ret(published.load(std::memory_order_acquire));
+    if (ret == NOTHING_PUBLISHED)
+    {
+      return pADC->getMin();
+    }
 
-  SmoothedADC(std::shared_ptr<MCP_Channel>inADC,
-              uint8_t buffSize = MAX_BUFFER_SIZE):
-      buffSize(buffSize),
-      pADC(inADC)
-  {
-    reset();
+    return (uint16_t)ret;
   }
 
-  void reset()
+  void fillBuffer(void)
   {
-    if (pdTRUE != lock())
+    do
     {
-      Serial.println("smth reset semtake failed");
-      while (1);
-    }
-
-    memset(&readings, 0, sizeof(uint16_t) * buffSize);
-    runningSum  = 0;
-    sampleCount = 0;
-    writeIndex = 0;
-    unlock();
+      service();
+    } while (!isFull());
   }
 
-  virtual void service(void) override
-  {
-        pADC->service();
-    uint16_t newestReading = pADC->read();
+  std::shared_ptr<ADC_Object> getSource(void) { return pADC; }
+};
 
-    if (pdTRUE != lock())
-    {
-      Serial.println("smth svc semtake failed");
-      while (1);
-    }
 
-    runningSum += newestReading;
-    if (sampleCount == buffSize)
-    {
-      runningSum -= readings[writeIndex];
-      readings[writeIndex] = newestReading;
-      ++writeIndex;
-      if (writeIndex == buffSize)
-      {
-        writeIndex = 0;
-      }
-    }
-    else
-    {
-      readings[sampleCount] = newestReading;
-      ++sampleCount;
-    }
-    unlock();
+////////////////////////////////////////////////////////////////////////////////////////////
+// FilteredADC using one of the policies from ADC_Filters.h, e.g.
+//
+//  SmoothedADC<BoxcarFilter<100>>    100-sample moving average
+//  SmoothedADC<Pow2BoxcarFilter<4>>  16-sample moving average, shift instead of divide
+//  SmoothedADC<EmaFilter<5>>         one-pole integer low-pass
+//  SmoothedADC<NoFilter>             no smoothing at all
+//  MedianADC<5>                      spike rejection only; since it's an ADC_Object itself,
+//                                    it can be stacked in front of any other smoothing
+//
+//  inADC: the ADC_Object to smooth
+template <typename Filter = BoxcarFilter<MAX_BUFFER_SIZE>>
+class SmoothedADC : public FilteredADC
+{
+protected:
+  Filter filter;
+
+public:
+  SmoothedADC(std::shared_ptr<ADC_Object>inADC):
+      FilteredADC(inADC)
+  {
+    filter.reset();
   }
 
-  virtual uint16_t read(void) override
+  SmoothedADC(ADC_Object *inADC):
+      SmoothedADC(std::shared_ptr<ADC_Object>(inADC))
+  { ; }
+
+  virtual void service(void) override
   {
-    if (sampleCount == 0)
-    {
-      return pADC->getMin();
-    }
+    pADC->service();
+    uint16_t newestReading = pADC->read();
 
-    if (pdTRUE != lock())
+    if (resetPending.exchange(false, std::memory_order_acq_rel))
     {
-      Serial.println("smth read semtake failed");
-      while (1);
+      filter.reset();
     }
 
-    uint16_t ret = (uint16_t)(runningSum / (uint64_t)sampleCount);
-    unlock();
-    return ret;
+    filter.push(newestReading);
+    published.store(filter.value(), std::memory_order_release);
   }
 
-  void fillBuffer(void)
+  virtual bool isFull(void) override
   {
-    while(sampleCount != buffSize)
-    {
-      service();
-    }
+    return filter.full();
   }
-};
\ No newline at end of file
+};
+
+
+////////////////////////////////////////////////////////////////////////////////////////////
+// Sliding-median prefilter for any ADC_Object
+template <uint8_t N>
+using MedianADC = SmoothedADC<MedianFilter<N>>;
@@ -0,0 +1,88 @@
+// ------------------------------------------------------------------------
+// BankDebouncer.h
+//
+// Debounces up to 32 digital inputs at once
+// ------------------------------------------------------------------------
+#ifndef BANK_DEBOUNCER_H
+#define BANK_DEBOUNCER_H
+
+#include <Arduino.h>
+#include <atomic>
+
+// Feed it one 32-bit snapshot of raw inputs per tick (GPIO register, HW_Mux::getReg(), a
+// shift register...), bit n == input n, 1 == closed. Each input gets its own two-bit
+// counter, stored "vertically" across two words (bit n of ct0 and ct1 are input n's
+// counter), so all 32 are counted with a handful of bitwise ops and no branches.
+//
+// An input has to read the same, different from its debounced state, four ticks in a row
+// before the debounced state follows it; any tick that agrees with the debounced state
+// starts the count over. At a 1ms tick that's a 4ms window; call it less often (e.g. every
+// 5ms) for bouncier switches.
+class BankDebouncer
+{
+  uint32_t ct0;
+  uint32_t ct1;
+  uint32_t pressed;    // Edges from the last service() only
+  uint32_t released;
+
+  std::atomic<uint32_t> debounced;
+
+  // Edges accumulated until a consumer takes them (like GateIn's rise/fall flags)
+  std::atomic<uint32_t> pendingPressed;
+  std::atomic<uint32_t> pendingReleased;
+
+public:
+
+  // initialState: debounced state to start from, e.g. a first raw read so buttons that are
+  // already held at power-up don't show up as presses
+  explicit BankDebouncer(uint32_t initialState = 0):
+    ct0(0xFFFFFFFF),
+    ct1(0xFFFFFFFF),
+    pressed(0),
+    released(0),
+    debounced(initialState),
+    pendingPressed(0),
+    pendingReleased(0)
+  { ; }
+
+  // Call once per tick from a single task. Returns the mask of inputs whose debounced state
+  // changed this tick.
+  uint32_t service(uint32_t raw)
+  {
+    uint32_t state(debounced.load(std::memory_order_relaxed));
+    uint32_t toggled(state ^ raw);
+
+    // Count inputs that differ, reset the ones that don't; whatever rolls over toggles
+    ct0      = ~(ct0 & toggled);
+    ct1      = ct0 ^ (ct1 & toggled);
+    toggled &= ct0 & ct1;
+
+    state   ^= toggled;
+    pressed  = toggled & state;
+    released = toggled & ~state;
+
+    debounced.store(state, std::memory_order_release);
+    if (toggled)
+    {
+      pendingPressed.fetch_or(pressed, std::memory_order_release);
+      pendingReleased.fetch_or(released, std::memory_order_release);
+    }
+
+    return toggled;
+  }
+
+  // Debounced state of every input. Safe from any task.
+  uint32_t getState(void) const { return debounced.load(std::memory_order_acquire); }
+  bool     isDown(uint8_t input) const { return (getState() >> input) & 1; }
+
+  // Inputs that closed / opened on the last service(); for the task that calls service()
+  uint32_t getPressed(void)  const { return pressed; }
+  uint32_t getReleased(void) const { return released; }
+
+  // Inputs that closed / opened at any point since the last call, cleared as they're read.
+  // Safe from any task.
+  uint32_t takePressed(void)  { return pendingPressed.exchange(0, std::memory_order_acq_rel); }
+  uint32_t takeReleased(void) { return pendingReleased.exchange(0, std::memory_order_acq_rel); }
+};
+
+#endif
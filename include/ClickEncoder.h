@@ -14,11 +14,21 @@
 
 #include <Arduino.h>
 #include <MagicButton.h>
+#include <QuadratureBank.h>
+#include <atomic>
 #include <memory>
 #include <RatFuncs.h>
 
 
 #define MUTEX_TIMEOUT 25
+
+// ----------------------------------------------------------------------------
+// Acceleration defaults (see ClickEncoder::setAcceleration())
+//
+const uint16_t ENC_ACCEL_TOP (3072);  // max. acceleration: *12 (val >> 8)
+const uint8_t  ENC_ACCEL_INC (25);    // Added per transition (stepsPerNotch per detent)
+const uint8_t  ENC_ACCEL_DEC (2);     // Taken away per millisecond between detents
+
 // ----------------------------------------------------------------------------
 
 class ClickEncoder
@@ -32,15 +42,36 @@ public:
                uint8_t stepsPerNotch = 4,
                bool usePullResistor  = true);
 
+  virtual ~ClickEncoder() { ; }
+
   SemaphoreHandle_t encoderMutex;
 
-  // Call every 1 ms in ISR
+  // Call every 1 ms in ISR. In interrupt mode this only services the button.
   virtual void service(void);
 
+  // Interrupt mode: decode from pin-change interrupts on A and B instead of in service().
+  // The ISR touches nothing but isrState, so readPosition() doesn't take the mutex either.
+  // The button is still polled, so keep calling service() every 1 ms if you use it; only
+  // the rotation stops depending on the poll rate. Returns false for encoders without pins
+  // of their own (e.g. MuxedEncoder), or if the encoder stayed busy.
+  bool enableInterrupts(bool enable = true);
+  bool interruptsEnabled(void) { return interruptMode.load(std::memory_order_acquire); }
+
   // Get current state and free for further updates
   int16_t      readPosition (void);
   ButtonState  readButton   (void);
 
+  // Moves that skipped a state since startup or the last reset (see QuadErrors); compare
+  // against how often you service the encoder to tell whether it's fast enough
+  QuadErrors   readErrors   (bool reset = false);
+
+  // Make fast turns cover more ground: each detent moves the position by up to
+  // 1 + top / 256, depending on how quickly it followed the last one
+  void setAcceleration(bool     enabled,
+                       uint16_t top = ENC_ACCEL_TOP,
+                       uint8_t  inc = ENC_ACCEL_INC,
+                       uint8_t  dec = ENC_ACCEL_DEC);
+
   bool lock(void);
   void unlock(void);
 
@@ -51,20 +82,43 @@ protected:
   const    bool     activeLow;
 
   volatile int16_t  delta;
-  volatile uint16_t acceleration;
   volatile int16_t  position;
   volatile long     lastEncoded;
   volatile long     MSB;
   volatile long     LSB;
 
-  bool              accelerationEnabled;
+  // Only the decoder (service() with the mutex held, or the ISR) touches acceleration and
+  // lastDetentMs; setAcceleration() hands it a new curve and a reset through the atomics
+  uint16_t              acceleration;
+  uint32_t              lastDetentMs;
+  std::atomic<bool>     accelerationEnabled;
+  std::atomic<uint32_t> accelCurve;   // top << 16 | inc << 8 | dec
+  std::atomic<bool>     accelReset;
   uint8_t           steps;
 
+  int8_t            lastDir;    // Direction of the last one-step move, for quadDecode()
+
+  // Interrupt-mode decoder state, packed into one word so a reader always sees a position
+  // and delta that belong together: position in bits 0-15, transitions since the last
+  // detent in 16-23, last AB in 24-25, lastDir + 1 in 26-27
+  std::atomic<uint32_t> isrState;
+  std::atomic<bool>     interruptMode;
+
+  std::atomic<uint32_t> skippedCount;
+  std::atomic<uint32_t> unrecoveredCount;
+
   bool              doubleClickable;
 
   virtual bool readA();
   virtual bool readB();
 
+  void decode(bool a, bool b);
+  void addTransitions(int8_t transitions);
+  int8_t decodeStep(uint8_t prev, uint8_t curr, int8_t &dir);
+  int16_t detentSize(void);
+
+  static void isrPinChange(void *pArg);
+
   std::shared_ptr<MagicButton> hwButton;
 
 public:
@@ -79,7 +79,9 @@ public:
                         uint8_t stepsPerNotch,
                         bool usePullResistors);
 
-  encEvnts getEvent(void);
+  // pDelta: if given, gets how far the position moved since the last call (more than one
+  // per detent with acceleration on; see ClickEncoder::setAcceleration())
+  encEvnts getEvent(int16_t *pDelta = nullptr);
 
   void flush();
 
@@ -4,6 +4,7 @@
 #include <memory>
 #include <ADC_Object.h>
 #include <vector>
+#include <atomic>
 #include <freertos/semphr.h>
 
 ////////////////////////////////////////////////
@@ -21,43 +22,237 @@ enum LockState
 // Unlock control when within this percent difference from the lockControl value
 static const double  DEFAULT_THRESHOLD(0.01);
 
+// Smoothing applied to a control's ADC unless you hand it an already-filtered one: the
+// same 100-sample moving average as always, just no longer padded out to 128 entries
+typedef BoxcarFilter<100> DefaultCtrlFilter;
+
+// One-pole alternative for SMOOTHING_LOW_RAM: settles about as quickly, in 8 bytes instead
+// of 208, but weights recent samples more heavily, so it responds a little differently
+typedef EmaFilter<5> LowRamCtrlFilter;
+
+////////////////////////////////////////////////
+// SMOOTHING_STEADY:   fixed smoothing (DefaultCtrlFilter)
+// SMOOTHING_ADAPTIVE: heavy smoothing at rest, next to no lag while the control is moving
+// SMOOTHING_LOW_RAM:  fixed smoothing with next to no storage (LowRamCtrlFilter)
+enum SmoothingMode
+{
+  SMOOTHING_STEADY = 0,
+  SMOOTHING_ADAPTIVE,
+  SMOOTHING_LOW_RAM
+};
+
+// Wrap inADC in the filter corresponding to [mode]
+inline std::shared_ptr<FilteredADC> makeCtrlFilter(std::shared_ptr<ADC_Object>inADC,
+                                                   SmoothingMode mode = SMOOTHING_STEADY)
+{
+  if (mode == SMOOTHING_ADAPTIVE)
+  {
+    return std::make_shared<SmoothedADC<AdaptiveFilter<>>>(inADC);
+  }
+
+  if (mode == SMOOTHING_LOW_RAM)
+  {
+    return std::make_shared<SmoothedADC<LowRamCtrlFilter>>(inADC);
+  }
+
+  return std::make_shared<SmoothedADC<DefaultCtrlFilter>>(inADC);
+}
+
+////////////////////////////////////////////////
+// Precomputed raw-ADC boundaries for slicing [rawMin, rawMax] into numVals control values,
+// with the hysteresis bands baked in, so tracking a control takes a couple of integer
+// compares instead of map() divides and float math. Tables are immutable; controls with
+// the same range share one via get().
+class QuantTable
+{
+  uint16_t rawMin;
+  uint16_t rawMax;
+  uint16_t numVals;
+
+  std::vector<uint16_t> sliceStart;  // Lowest raw value in each slice (+ one past the end)
+  std::vector<uint16_t> sliceBase;   // What controlValToRawVal() has always returned
+  std::vector<uint16_t> upThresh;    // Raw value must be ABOVE this to move up into a slice
+  std::vector<uint16_t> downThresh;  // Raw value must be BELOW this to move down out of one
+
+public:
+
+  QuantTable(uint16_t min, uint16_t max, uint16_t numVals);
+
+  // Shared table for this range, built on first use
+  static std::shared_ptr<const QuantTable> get(uint16_t min, uint16_t max, uint16_t numVals);
+
+  // Control value for [rawVal]; [hint] (e.g. the current value) makes the usual case O(1)
+  uint16_t slice(uint16_t rawVal, uint16_t hint = 0) const;
+
+  // ADC reading corresponding to control value [ctrlVal]
+  uint16_t sliceToRaw(uint16_t ctrlVal) const
+  {
+    return sliceBase[(ctrlVal > numVals) ? numVals : ctrlVal];
+  }
+
+  // Apply hysteresis: the value an unlocked control currently at [ctrlVal] should take
+  uint16_t track(uint16_t rawVal, uint16_t ctrlVal) const;
+
+  bool matches(uint16_t min, uint16_t max, uint16_t num) const
+  {
+    return (rawMin == min) && (rawMax == max) && (numVals == num);
+  }
+};
+
+////////////////////////////////////////////////
+// Scale masks are relative to the root: bit 0 is the root, bit 1 a semitone up, etc.
+static const uint16_t SCALE_CHROMATIC       (0xFFF);
+static const uint16_t SCALE_MAJOR           (0xAB5);
+static const uint16_t SCALE_NATURAL_MINOR   (0x5AD);
+static const uint16_t SCALE_MAJOR_PENTATONIC(0x295);
+static const uint16_t SCALE_MINOR_PENTATONIC(0x4A9);
+
+////////////////////////////////////////////////
+// Lookup from scale degree (0 = lowest in-scale note in range) to note number for one
+// scale / root / note range, so a control can hand out in-scale notes with no per-read
+// quantization. Tables are immutable; controls playing the same scale share one via get().
+class ScaleMap
+{
+  uint16_t scaleMask;
+  uint8_t  root;
+  uint8_t  lowNote;
+  uint8_t  highNote;
+
+  std::vector<uint8_t> notes;  // In-scale note numbers in [lowNote, highNote], ascending
+
+public:
+
+  ScaleMap(uint16_t mask, uint8_t root, uint8_t lowNote, uint8_t highNote);
+
+  // Shared table for this scale, built on first use
+  static std::shared_ptr<const ScaleMap> get(uint16_t mask,
+                                             uint8_t root,
+                                             uint8_t lowNote,
+                                             uint8_t highNote);
+
+  uint16_t numDegrees(void) const { return notes.size(); }
+
+  uint8_t degreeToNote(uint16_t degree) const
+  {
+    return notes[(degree < notes.size()) ? degree : notes.size() - 1];
+  }
+
+  bool matches(uint16_t mask, uint8_t root, uint8_t lowNote, uint8_t highNote) const
+  {
+    return (scaleMask == mask) && (this->root == root)
+        && (this->lowNote == lowNote) && (this->highNote == highNote);
+  }
+};
+
+////////////////////////////////////////////////
+// One control's settings in one mode, as stored in a saved scene (see
+// ControllerBank::exportScenes()). Fixed size and layout; don't reorder.
+struct SceneRecord
+{
+  uint16_t lockVal;
+  uint16_t rangeMin;
+  uint16_t rangeMax;
+  uint8_t  lockState;
+  uint8_t  reserved;
+};
+
 class ControlObject
 {
 private:
   SemaphoreHandle_t mutex;
   bool lock();
   void unlock();
+  void update();
+  void publish();
+  void rebuildTable();
 
 protected:
-  volatile LockState lockState;
+  std::atomic<LockState> lockState;
   volatile uint16_t  lockCtrlVal;
 
   volatile uint16_t  currentRawVal;
   uint16_t  numCtrlVals;
+
+  // Raw range this control maps onto; kept here rather than on the filter, which may be
+  // shared with other controls on the same channel
+  uint16_t  rangeMin;
+  uint16_t  rangeMax;
+  std::shared_ptr<const QuantTable> pTable;
+
+  // When a scale is set, control values are scale degrees and numCtrlVals is the number
+  // of degrees in range; linearNumVals remembers what it was before
+  std::shared_ptr<const ScaleMap> pScale;
+  uint16_t  linearNumVals;
   bool smoothed;
-  std::shared_ptr<SmoothedADC> pADC;
+  std::shared_ptr<FilteredADC> pADC;
+
+  // Last computed control value (and note, if there's a scale); this is all read() looks at
+  std::atomic<uint16_t> controlVal;
+  std::atomic<uint16_t> controlNote;
+  bool serviceOnRead;
 
 public:
 
   ControlObject(ADC_Object *inADC,
                 uint16_t numVals,
-                uint16_t defaultControlVal = 0):
+                uint16_t defaultControlVal = 0,
+                SmoothingMode smoothing = SMOOTHING_STEADY):
       lockState(STATE_LOCKED),
       numCtrlVals(numVals),
-      lockCtrlVal(defaultControlVal)
+      lockCtrlVal(defaultControlVal),
+      currentRawVal(0),
+      controlVal(defaultControlVal),
+      controlNote(defaultControlVal),
+      linearNumVals(numVals),
+      serviceOnRead(false)
   {
-    pADC = std::make_shared<SmoothedADC>(std::shared_ptr<ADC_Object>(inADC), 100);
+    pADC = makeCtrlFilter(std::shared_ptr<ADC_Object>(inADC), smoothing);
+    rangeMin = pADC->getMin();
+    rangeMax = pADC->getMax();
+    rebuildTable();
     mutex = xSemaphoreCreateRecursiveMutex();
   }
 
   ControlObject(std::shared_ptr<ADC_Object>inADC,
+                uint16_t numVals,
+                uint16_t defaultControlVal = 0,
+                SmoothingMode smoothing = SMOOTHING_STEADY):
+      lockState(STATE_LOCKED),
+      numCtrlVals(numVals),
+      lockCtrlVal(defaultControlVal),
+      currentRawVal(0),
+      controlVal(defaultControlVal),
+      controlNote(defaultControlVal),
+      linearNumVals(numVals),
+      serviceOnRead(false)
+  {
+    pADC = makeCtrlFilter(inADC, smoothing);
+    rangeMin = pADC->getMin();
+    rangeMax = pADC->getMax();
+    rebuildTable();
+    mutex = xSemaphoreCreateRecursiveMutex();
+  }
+
+  // Use this one to pick your own filter, e.g. std::make_shared<SmoothedADC<NoFilter>>(pCh),
+  // or to share one filter between several controls on the same channel
+  template <typename FilteredType,
+            typename = std::enable_if_t<std::is_base_of<FilteredADC, FilteredType>::value>>
+  ControlObject(std::shared_ptr<FilteredType>inSmoothedADC,
                 uint16_t numVals,
                 uint16_t defaultControlVal = 0):
       lockState(STATE_LOCKED),
       numCtrlVals(numVals),
-      lockCtrlVal(defaultControlVal)
+      lockCtrlVal(defaultControlVal),
+      pADC(inSmoothedADC),
+      rangeMin(inSmoothedADC->getMin()),
+      rangeMax(inSmoothedADC->getMax()),
+      currentRawVal(0),
+      controlVal(defaultControlVal),
+      controlNote(defaultControlVal),
+      linearNumVals(numVals),
+      serviceOnRead(false)
   {
-    pADC = std::make_shared<SmoothedADC>(inADC, 100);
+    rebuildTable();
     mutex = xSemaphoreCreateRecursiveMutex();
   }
 
@@ -73,9 +268,33 @@ public:
   uint16_t  rawValToControlVal(uint16_t rawVal);
   uint16_t  controlValToRawVal(uint16_t tgtVal);
 
+  // service() is the only thing that samples the hardware; read() just returns the value
+  // it computed, so it's cheap and safe to call from any task as often as you like
   uint16_t  read(void);
   void      service(void);
   void      overWrite(void);
+
+  // Whatever the last service() published; unlike read(), never samples anything
+  uint16_t  peek(void) { return controlVal.load(std::memory_order_acquire); }
+
+  // Save / restore lock value, range and lock state under a single lock. A control that was
+  // saved unlocked comes back waiting to be picked up, since the hardware has likely moved.
+  // importSettings() turns away (returns false for) anything canImport() doesn't accept.
+  void      exportSettings(SceneRecord &rec);
+  bool      importSettings(const SceneRecord &rec);
+  bool      canImport(const SceneRecord &rec);
+
+  // Map the control onto the notes of a scale between lowNote and highNote (inclusive).
+  // Lock values, unlocking and read() all work in scale degrees; readNote() gives the note.
+  // Pass nullptr to setScaleMap() to go back to plain linear values.
+  void      setScale(uint16_t scaleMask, uint8_t root, uint8_t lowNote, uint8_t highNote);
+  void      setScaleMap(std::shared_ptr<const ScaleMap> pMap);
+  std::shared_ptr<const ScaleMap> getScaleMap(void);
+  uint16_t  readNote(void);
+
+  // Legacy behavior: sample the ADC on every read() as well. Only for callers that never
+  // call service() themselves.
+  void      setServiceOnRead(bool enable = true) { serviceOnRead = enable; }
   ////////////////////////////////////////////////
   // Double equal all the way across the sky
   friend bool operator == (const ControlObject& CO1, const ControlObject& CO2)
@@ -2,9 +2,129 @@
 
 #include <Arduino.h>
 #include <MultimodeControl.h>
+#include <SeqLock.h>
+#include <FS.h>
+#include <atomic>
+#include <cstring>
 #include <vector>
 #include <freertos/semphr.h>
 
+// Most controls one bank can hold (one bit each in BankSnapshot::lockMask)
+static const uint8_t MAX_BANK_CONTROLS(32);
+
+////////////////////////////////////////////////
+// Everything a consumer needs from a ControllerBank, captured at one instant
+//
+//  sequence:     bumps every time a new snapshot is published
+//  lockMask:     bit n is set if control n is locked (i.e. not following the hardware)
+//  changedVals:  bit n is set if control n's value differs from the previous snapshot
+//  changedLocks: bit n is set if control n's lock state differs from the previous snapshot
+//  vals:         control values, indexed by (position-mapped) control number
+struct BankSnapshot
+{
+  uint32_t sequence;
+  uint32_t lockMask;
+  uint32_t changedVals;
+  uint32_t changedLocks;
+  uint16_t vals[MAX_BANK_CONTROLS];
+};
+
+////////////////////////////////////////////////
+// Saved scenes (see ControllerBank::exportScenes()) are this header followed by one
+// SceneRecord per control per mode: control 0 modes 0..N-1, then control 1, and so on.
+// Native byte order (little-endian on the ESP32).
+static const uint32_t SCENE_MAGIC  (0x4E435353);   // "SSCN"
+static const uint16_t SCENE_VERSION(1);
+
+struct SceneHeader
+{
+  uint32_t magic;
+  uint16_t version;
+  uint8_t  controlCount;
+  uint8_t  modeCount;
+};
+
+// Morph positions are Q16: 0 is all scene A, MORPH_FULL is all scene B
+static const uint32_t MORPH_FULL((uint32_t)1 << 16);
+
+// Called, with the bank unlocked, after anything publishes a change: service() on every
+// tick where a control moves, and scene selection, morphing and imports from whichever task
+// called them. Keep it short.
+typedef void (*BankChangeCallback)(uint32_t changedVals, uint32_t changedLocks, void *pArg);
+
+////////////////////////////////////////////////
+// Collects the change masks from every snapshot a bank publishes, so that a consumer that
+// doesn't look at every snapshot still finds out about everything that moved since it last
+// asked (same idea as GateIn's rise/fall flags), and passes them on to an optional callback
+class BankChangeTracker
+{
+  std::atomic<uint32_t> pendingVals;
+  std::atomic<uint32_t> pendingLocks;
+
+  // Same again, for the callback: everything published since the last notify()
+  std::atomic<uint32_t> unnotifiedVals;
+  std::atomic<uint32_t> unnotifiedLocks;
+
+  BankChangeCallback callback;
+  void              *pCallbackArg;
+
+public:
+
+  BankChangeTracker():
+    pendingVals(0),
+    pendingLocks(0),
+    unnotifiedVals(0),
+    unnotifiedLocks(0),
+    callback(nullptr),
+    pCallbackArg(nullptr)
+  { ; }
+
+  // Only call from the task that publishes snapshots
+  void setCallback(BankChangeCallback cb, void *pArg)
+  {
+    callback     = cb;
+    pCallbackArg = pArg;
+  }
+
+  // Fold one snapshot's changes in. Returns true if there were any.
+  bool record(const BankSnapshot &snap)
+  {
+    if (!(snap.changedVals | snap.changedLocks))
+    {
+      return false;
+    }
+
+    pendingVals.fetch_or(snap.changedVals, std::memory_order_release);
+    pendingLocks.fetch_or(snap.changedLocks, std::memory_order_release);
+    unnotifiedVals.fetch_or(snap.changedVals, std::memory_order_release);
+    unnotifiedLocks.fetch_or(snap.changedLocks, std::memory_order_release);
+    return true;
+  }
+
+  // Pass everything recorded since the last call to the callback, in one go. Call it with
+  // the bank unlocked after anything that publishes.
+  void notify(void)
+  {
+    uint32_t vals(unnotifiedVals.exchange(0, std::memory_order_acq_rel));
+    uint32_t locks(unnotifiedLocks.exchange(0, std::memory_order_acq_rel));
+    if (callback && (vals | locks))
+    {
+      callback(vals, locks, pCallbackArg);
+    }
+  }
+
+  // Everything that changed since the last call, cleared as it's read
+  uint32_t takeChangedVals(void)
+  {
+    return pendingVals.exchange(0, std::memory_order_acq_rel);
+  }
+
+  uint32_t takeChangedLocks(void)
+  {
+    return pendingLocks.exchange(0, std::memory_order_acq_rel);
+  }
+};
+
 class ControllerBank
 {
   uint8_t currentMode;
@@ -12,10 +132,25 @@ class ControllerBank
   uint8_t modeCount;
 
   std::vector<MultiModeCtrl> controls;
-  std::vector<bool>          locks;
-  std::vector<uint16_t>      vals;
   std::vector<uint8_t>       positionMapping;
 
+  // Built on the service side, read lock-free by everyone else
+  BankSnapshot           working = {};
+  SeqLock<BankSnapshot>  published;
+  BankChangeTracker      changes;
+
+  // Scene morph: both scenes' lock values are cached when the morph starts, so each tick is
+  // one multiply-add per control with no per-control locks
+  bool     morphing       = false;
+  uint32_t morphPos       = 0;   // Q16, see MORPH_FULL
+  uint16_t morphTicks     = 0;   // 0 == driven by setMorphPosition()
+  uint16_t morphTick      = 0;
+  uint16_t morphFrom[MAX_BANK_CONTROLS] = {};
+  int32_t  morphDelta[MAX_BANK_CONTROLS] = {};
+
+  // Shared scan of the MCP ADC, if this bank is built on one
+  std::shared_ptr<MCP_ScanFrame> pFrame;
+
   SemaphoreHandle_t mutex;
   static inline const TickType_t PATIENCE = 10;
 
@@ -34,6 +169,81 @@ class ControllerBank
     xSemaphoreGiveRecursive(mutex);
   }
 
+  // Capture every control's value and lock state and publish them as one snapshot, along
+  // with what changed since the last one. Only call with the bank mutex held.
+  void publishSnapshot()
+  {
+    assert(controlCount <= MAX_BANK_CONTROLS);
+    uint32_t prevLocks(working.lockMask);
+
+    ++working.sequence;
+    working.lockMask    = 0;
+    working.changedVals = 0;
+    if (morphing)
+    {
+      publishMorph(prevLocks);
+      return;
+    }
+
+    for (uint8_t n = 0; n < controlCount; ++n)
+    {
+      uint16_t val(getPtr(n)->peek());
+      if (val != working.vals[n])
+      {
+        working.changedVals |= ((uint32_t)1 << n);
+        working.vals[n] = val;
+      }
+
+      if (getPtr(n)->getLockState() != STATE_UNLOCKED)
+      {
+        working.lockMask |= ((uint32_t)1 << n);
+      }
+    }
+    working.changedLocks = working.lockMask ^ prevLocks;
+
+    published.write(working);
+    changes.record(working);
+  }
+
+  // publishSnapshot() for while a morph is running: every control is locked and shows the
+  // blend of the two scenes. Only call with the bank mutex held.
+  void publishMorph(uint32_t prevLocks)
+  {
+    for (uint8_t n = 0; n < controlCount; ++n)
+    {
+      uint16_t val(morphFrom[n] + (int32_t)(((int64_t)morphDelta[n] * morphPos + (MORPH_FULL >> 1)) >> 16));
+      if (val != working.vals[n])
+      {
+        working.changedVals |= ((uint32_t)1 << n);
+        working.vals[n] = val;
+      }
+    }
+    working.lockMask     = (controlCount == 32) ? 0xFFFFFFFF : (((uint32_t)1 << controlCount) - 1);
+    working.changedLocks = working.lockMask ^ prevLocks;
+
+    published.write(working);
+    changes.record(working);
+  }
+
+  void scanFrame()
+  {
+    if (pFrame != nullptr)
+    {
+      pFrame->service();
+    }
+  }
+
+  void addMCP_Channels(std::shared_ptr<MCP_ADC>pADC,
+                       uint8_t channelCount,
+                       uint16_t topOfRange)
+  {
+    pFrame = std::make_shared<MCP_ScanFrame>(pADC);
+    for (uint8_t n(0); n < channelCount; ++n)
+    {
+      controls.push_back(MultiModeCtrl(std::make_shared<MCP_Channel>(pFrame, n), modeCount, topOfRange));
+    }
+  }
+
 public:
 
   ControllerBank(uint8_t controlCount,
@@ -62,8 +272,6 @@ public:
     for (uint8_t n(0); n < controlCount; ++n)
     {
       controls.push_back(MultiModeCtrl(std::make_shared<ESP32_ADC_Channel>(pins[n]), modeCount, topOfRange));
-      vals.push_back(0);
-      locks.push_back(0);
     }
   }
 
@@ -75,28 +283,19 @@ public:
                  uint8_t channelCount,
                  uint8_t modeCount,
                  uint16_t topOfRange):
-    mutex(xSemaphoreCreateRecursiveMutex())
-  {
-    for (uint8_t n(0); n < channelCount; ++n)
-    {
-      controls.push_back(MultiModeCtrl(std::make_shared<MCP_Channel>(pADC, n), modeCount, topOfRange));
-      vals.push_back(0);
-      locks.push_back(0);
-    }
-  }
+    ControllerBank(std::shared_ptr<MCP_ADC>(pADC), channelCount, modeCount, topOfRange)
+  { ; }
 
   ControllerBank(std::shared_ptr<MCP_ADC>pADC,
                  uint8_t channelCount,
                  uint8_t modeCount,
                  uint16_t topOfRange):
+    currentMode(0),
+    controlCount(channelCount),
+    modeCount(modeCount),
     mutex(xSemaphoreCreateRecursiveMutex())
   {
-    for (uint8_t n(0); n < channelCount; ++n)
-    {
-      controls.push_back(MultiModeCtrl(std::make_shared<MCP_Channel>(pADC, n), modeCount, topOfRange));
-      vals.push_back(0);
-      locks.push_back(0);
-    }
+    addMCP_Channels(pADC, channelCount, topOfRange);
   }
 
 
@@ -177,15 +376,11 @@ public:
 
     assert(pADC != nullptr);
     pADC->setGPIOpins(clock, miso, mosi, cs);
+    this->currentMode  = 0;
     this->modeCount    = modeCount;
     this->controlCount = controlCount;
 
-    for (uint8_t n(0); n < controlCount; ++n)
-    {
-      controls.push_back(MultiModeCtrl(std::make_shared<MCP_Channel>(pADC, n), modeCount, topOfRange));
-      vals.push_back(0);
-      locks.push_back(0);
-    }
+    addMCP_Channels(pADC, controlCount, topOfRange);
   }
 
   void init(const uint8_t *pins,
@@ -196,8 +391,6 @@ public:
       pinMode(pins[n], INPUT);
       auto pESP_ADC = std::make_shared<ESP32_ADC_Channel>(pins[n]);
       controls.push_back(MultiModeCtrl(pESP_ADC, modeCount, topOfRange));
-      vals.push_back(0);
-      locks.push_back(0);
     }
   }
 
@@ -239,59 +432,329 @@ public:
 
   void selectScene(uint8_t sceneIdx, bool reqUnlock = true)
   {
-    lock();
+    if (!lock())
+    {
+      return;
+    }
+
     currentMode = sceneIdx;
     for (uint8_t n(0); n < controlCount; ++n)
     {
       controls[getPositionMappedIndex(n)].selectMode(currentMode, reqUnlock);
     }
+    publishSnapshot();
+    unlock();
+
+    changes.notify();
+  }
+
+  // Crossfade every control from scene A's stored values to scene B's. With ticks > 0, each
+  // service() takes one step and the morph lands on B after that many; with ticks == 0, it
+  // only moves when you call setMorphPosition(). Controls read as locked until stopMorph()
+  // hands the bank back to the active scene (which is untouched by all this).
+  void startMorph(uint8_t sceneA, uint8_t sceneB, uint16_t ticks = 0)
+  {
+    sceneA = (sceneA < modeCount) ? sceneA : modeCount - 1;
+    sceneB = (sceneB < modeCount) ? sceneB : modeCount - 1;
+
+    if (!lock())
+    {
+      return;
+    }
+
+    for (uint8_t n(0); n < controlCount; ++n)
+    {
+      MultiModeCtrl &ctrl(controls[getPositionMappedIndex(n)]);
+      uint16_t a(ctrl.getPtr(sceneA)->peek());
+      uint16_t b(ctrl.getPtr(sceneB)->peek());
+      morphFrom[n]  = a;
+      morphDelta[n] = (int32_t)b - a;
+    }
+
+    morphPos   = 0;
+    morphTicks = ticks;
+    morphTick  = 0;
+    morphing   = true;
+    publishSnapshot();
+    unlock();
+
+    changes.notify();
+  }
+
+  // Q16, 0 (scene A) to MORPH_FULL (scene B)
+  void setMorphPosition(uint32_t pos)
+  {
+    if (!lock())
+    {
+      return;
+    }
+
+    morphPos = (pos < MORPH_FULL) ? pos : MORPH_FULL;
+    publishSnapshot();
+    unlock();
+
+    changes.notify();
+  }
+
+  uint32_t getMorphPosition(void) { return morphPos; }
+  bool     isMorphing(void)       { return morphing; }
+
+  void stopMorph(void)
+  {
+    if (!lock())
+    {
+      return;
+    }
+
+    morphing = false;
+    publishSnapshot();
     unlock();
+
+    changes.notify();
   }
 
+  // Service every control, then publish a fresh snapshot. If anything changed, the change
+  // callback runs afterwards, from this task, with the bank unlocked. Skips the tick if
+  // the bank is busy (e.g. mid-import).
   void service()
   {
-    lock();
+    if (!lock())
+    {
+      return;
+    }
+
+    scanFrame();
     for (uint8_t n(0); n < controlCount; ++n)
     {
       getPtr(n)->service();
     }
+
+    if (morphing && (morphTick < morphTicks))
+    {
+      ++morphTick;
+      morphPos = ((uint32_t)morphTick << 16) / morphTicks;
+    }
+
+    publishSnapshot();
+    unlock();
+
+    changes.notify();
+  }
+
+  // Get called with the change masks whenever something publishes a change.
+  // Pass nullptr to stop.
+  void setChangeCallback(BankChangeCallback cb, void *pArg = nullptr)
+  {
+    if (!lock())
+    {
+      return;
+    }
+
+    changes.setCallback(cb, pArg);
     unlock();
   }
 
-  // Call this once to update all the read() values. Saves a bunch of mutex calls.
+  // Bit n is set if control n's value / lock state changed at any point since the last
+  // call; e.g.
+  //
+  //   uint32_t moved(bank.takeChangedVals());
+  //   while (moved)
+  //   {
+  //     uint8_t n(__builtin_ctz(moved));
+  //     moved &= moved - 1;
+  //     handle(n, bank.read(n));
+  //   }
+  uint32_t takeChangedVals(void)
+  {
+    return changes.takeChangedVals();
+  }
+
+  uint32_t takeChangedLocks(void)
+  {
+    return changes.takeChangedLocks();
+  }
+
+  // Copies out the latest snapshot. Lock-free, like getSnapshot(); values are as of the
+  // last service() or scene change.
   void readAll(uint16_t *getVals = nullptr, bool *getLocks = nullptr)
   {
-    lock();
+    BankSnapshot snap(published.read());
     for (uint8_t n = 0; n < controlCount; ++n)
     {
-      vals[n] = getPtr(n)->read();
       if (getVals)
       {
-        getVals[n] = vals[n];
+        getVals[n] = snap.vals[n];
       }
 
-      locks[n] = (getPtr(n)->getLockState() != STATE_UNLOCKED);
       if (getLocks)
       {
-        getLocks[n] = locks[n];
+        getLocks[n] = (snap.lockMask >> n) & 1;
+      }
+    }
+  }
+
+  // Bytes needed to export every scene in this bank
+  size_t sceneDataSize(void)
+  {
+    return sizeof(SceneHeader) + (size_t)controlCount * modeCount * sizeof(SceneRecord);
+  }
+
+  // Writes lock value, range and lock state for every control in every mode to buf.
+  // Returns the number of bytes written, or 0 if buf is smaller than sceneDataSize() or
+  // the bank is busy.
+  size_t exportScenes(uint8_t *buf, size_t bufSize)
+  {
+    size_t size(sceneDataSize());
+    if ((buf == nullptr) || (bufSize < size))
+    {
+      return 0;
+    }
+
+    SceneHeader header;
+    header.magic        = SCENE_MAGIC;
+    header.version      = SCENE_VERSION;
+    header.controlCount = controlCount;
+    header.modeCount    = modeCount;
+    memcpy(buf, &header, sizeof(header));
+    buf += sizeof(header);
+
+    if (!lock())
+    {
+      return 0;
+    }
+
+    for (uint8_t n(0); n < controlCount; ++n)
+    {
+      for (uint8_t mode(0); mode < modeCount; ++mode)
+      {
+        SceneRecord rec;
+        controls[n].getPtr(mode)->exportSettings(rec);
+        memcpy(buf, &rec, sizeof(rec));
+        buf += sizeof(rec);
       }
     }
     unlock();
+
+    return size;
   }
 
-  uint16_t read(uint8_t controlIdx)
+  // Restores everything exportScenes() wrote. Only the active mode's controls can come
+  // back unlocked (and they'll have to be picked up again); the others stay locked, same as
+  // after selectScene(). Returns false, changing nothing, if the data is from a different
+  // format version or a bank with a different number of controls or modes, if any record
+  // is out of range (see ControlObject::canImport()), or if the bank is busy.
+  bool importScenes(const uint8_t *buf, size_t len)
   {
-    lock();
-    uint16_t ret = vals[controlIdx];
+    SceneHeader header;
+    if ((buf == nullptr) || (len < sizeof(header)))
+    {
+      return false;
+    }
+
+    memcpy(&header, buf, sizeof(header));
+    if ((header.magic        != SCENE_MAGIC)
+     || (header.version      != SCENE_VERSION)
+     || (header.controlCount != controlCount)
+     || (header.modeCount    != modeCount)
+     || (len < sceneDataSize()))
+    {
+      return false;
+    }
+    buf += sizeof(header);
+
+    if (!lock())
+    {
+      return false;
+    }
+
+    // Check every record before touching anything, so a corrupt one can't leave the bank
+    // half loaded
+    const uint8_t *pRec(buf);
+    for (uint8_t n(0); n < controlCount; ++n)
+    {
+      for (uint8_t mode(0); mode < modeCount; ++mode)
+      {
+        SceneRecord rec;
+        memcpy(&rec, pRec, sizeof(rec));
+        pRec += sizeof(rec);
+
+        if (!controls[n].getPtr(mode)->canImport(rec))
+        {
+          unlock();
+          return false;
+        }
+      }
+    }
+
+    for (uint8_t n(0); n < controlCount; ++n)
+    {
+      for (uint8_t mode(0); mode < modeCount; ++mode)
+      {
+        SceneRecord rec;
+        memcpy(&rec, buf, sizeof(rec));
+        buf += sizeof(rec);
+
+        if (mode != controls[n].activeIndex)
+        {
+          rec.lockState = STATE_LOCKED;
+        }
+        controls[n].getPtr(mode)->importSettings(rec);
+      }
+    }
+    publishSnapshot();
     unlock();
-    return ret;
+
+    changes.notify();
+    return true;
+  }
+
+  // Same as exportScenes() / importScenes(), to / from a file, e.g.
+  //
+  //   bank.saveScenes(LittleFS, "/scenes.bin");
+  bool saveScenes(fs::FS &fs, const char *path)
+  {
+    std::vector<uint8_t> buf(sceneDataSize());
+    size_t size(exportScenes(buf.data(), buf.size()));
+
+    fs::File file(fs.open(path, FILE_WRITE));
+    if (!file)
+    {
+      return false;
+    }
+
+    bool ok(file.write(buf.data(), size) == size);
+    file.close();
+    return ok;
+  }
+
+  bool loadScenes(fs::FS &fs, const char *path)
+  {
+    fs::File file(fs.open(path, FILE_READ));
+    if (!file)
+    {
+      return false;
+    }
+
+    std::vector<uint8_t> buf(sceneDataSize());
+    size_t len(file.read(buf.data(), buf.size()));
+    file.close();
+
+    return importScenes(buf.data(), len);
+  }
+
+  // The latest consistent view of every control. Lock-free; safe from any task or core.
+  BankSnapshot getSnapshot(void)
+  {
+    return published.read();
+  }
+
+  uint16_t read(uint8_t controlIdx)
+  {
+    return published.read().vals[controlIdx];
   }
 
   bool isLocked(uint8_t controlIdx)
   {
-    lock();
-    bool ret = locks[controlIdx];
-    unlock();
-    return ret;
+    return (published.read().lockMask >> controlIdx) & 1;
   }
-};
+};
\ No newline at end of file
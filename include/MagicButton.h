@@ -8,9 +8,13 @@
 #define MagicButton_h
 
 #include <Arduino.h>
+#include <BankDebouncer.h>
 #include <CD4067.h>
+#include <array>
+#include <atomic>
 #include <memory>
 #include <DirectIO.h>
+#include <SpscQueue.h>
 #include <freertos/semphr.h>
 
 
@@ -46,12 +50,36 @@ typedef enum Button_e
 const uint16_t debounceUP(0b0111111111111111);  // More leading zeros will increase sensitivity
 const int16_t  debounceDN(~debounceUP);
 
-// Button configuration (values for 1ms timer service calls)
+// Button configuration (milliseconds)
 //
 const uint16_t DOUBLECLICKTIME(150);  // Count two clicks as doubleclick if both received within this time
 const uint16_t PRESSTIME(250);
 const uint16_t HOLDTIME(350);        // Report held button after time
 
+// Per-button gesture timing, all measured from the last debounced press or release.
+// A doubleClick of 0 turns double-clicks off: a click is reported as soon as it's released.
+struct ButtonTiming
+{
+  uint16_t doubleClick;
+  uint16_t press;
+  uint16_t hold;
+};
+
+static const ButtonTiming DEFAULT_BUTTON_TIMING{DOUBLECLICKTIME, PRESSTIME, HOLDTIME};
+
+// One reported gesture (Clicked, DoubleClicked, Pressed, Held or ClickedAndHeld)
+//  timestamp: the tick's millis() when it was recognized
+//  id:        whatever id the button was given in attachEventQueue()
+struct ButtonEvent
+{
+  uint32_t    timestamp;
+  uint8_t     id;
+  ButtonState gesture;
+};
+
+static const uint16_t BUTTON_QUEUE_SIZE(32);
+typedef SpscQueue<ButtonEvent, BUTTON_QUEUE_SIZE> ButtonEventQueue;
+
 class MagicButton
 {
 protected:
@@ -65,9 +93,15 @@ protected:
   volatile ButtonState state[2];
   volatile bool buttonDown;  // Raw data. We don't need to see it, we don't want to see it.
   volatile bool outputCleared;
-  volatile long long debounceTS;
+  volatile uint32_t debounceTS;  // millis() of the last debounced press or release
   volatile uint16_t buff;        // Moving window to record multiple readings
 
+  // How long each gesture state waits before its timeout transition, indexed by ButtonState
+  uint32_t timeouts[8];
+
+  ButtonEventQueue *pEvents;
+  uint8_t           eventId;
+
   bool lock()
   {
     if (xSemaphoreTakeRecursive(mutex, PATIENCE) != pdTRUE)
@@ -98,6 +132,8 @@ protected:
 
   SemaphoreHandle_t mutex;
 
+  void updateState(uint32_t now);
+
 #ifdef DEBUG_BUTTON_STATES
   ButtonState tmpState[2];
 #endif
@@ -116,15 +152,34 @@ public:
     outputCleared(1),
     doubleClickable(doubleClickable),
     mutex(xSemaphoreCreateRecursiveMutex()),
-    state{ButtonState::Open, ButtonState::Open}
+    state{ButtonState::Open, ButtonState::Open},
+    pEvents(nullptr),
+    eventId(0)
   {
+    setTiming(DEFAULT_BUTTON_TIMING);
     if (pin != -1)
     {
       pinMode(pin, pullup ? INPUT_PULLUP : INPUT);
     }
   }
 
-  void service();
+  // Change this button's gesture timing (see ButtonTiming)
+  void setTiming(const ButtonTiming &timing);
+
+  // Push every gesture into pQueue, tagged with id, instead of latching it for read(), so
+  // nothing gets lost between polls. Any number of buttons can share a queue as long as
+  // they're all serviced from the same task (it has one producer). Pass nullptr to go back
+  // to read().
+  void attachEventQueue(ButtonEventQueue *pQueue, uint8_t id = 0);
+
+  // now: millis() at this tick. Read it once and pass it to every button you service; all
+  // the arithmetic on it is wraparound-safe.
+  void service(uint32_t now);
+  void serviceDebounced(bool isDown, uint32_t now);
+
+  void service()                     { service(millis()); }
+  void serviceDebounced(bool isDown) { serviceDebounced(isDown, millis()); }
+
   ButtonState read();
 };
 
@@ -163,4 +218,120 @@ public:
   }
 };
 
+
+// All the buttons on one CD4067, serviced together: one read of the mux register, one
+// debounce of all 16 lines, and one timestamp per tick, instead of every MuxedButton
+// locking itself and the mux to fish out its own bit
+class MuxButtonPanel
+{
+  static const uint8_t MAX_BUTTONS = 16;
+
+  std::shared_ptr<HW_Mux> pMux;
+  bool scanMux;
+
+  BankDebouncer debouncer;
+  std::array<std::shared_ptr<MagicButton>, MAX_BUTTONS> buttons;
+  uint16_t attached;
+
+  uint16_t holdTime;
+  uint32_t downSince[MAX_BUTTONS];
+  std::atomic<uint16_t> heldMask;
+
+public:
+
+  // pMux:    the mux the buttons are on
+  // scanMux: true if the panel should scan the mux itself at the top of each service();
+  //          false if something else already does (e.g. there's other stuff on it too)
+  MuxButtonPanel(std::shared_ptr<HW_Mux> pMux, bool scanMux = true):
+    pMux(pMux),
+    scanMux(scanMux),
+    attached(0),
+    holdTime(HOLDTIME),
+    downSince{},
+    heldMask(0)
+  { ; }
+
+  // Make a button for mux channel [bit]; nullptr if there's no such channel
+  std::shared_ptr<MagicButton> addButton(uint8_t bit, bool doubleClickable = true)
+  {
+    if (bit >= MAX_BUTTONS)
+    {
+      return nullptr;
+    }
+
+    auto pButton(std::make_shared<MagicButton>(-1, false, doubleClickable));
+    buttons[bit] = pButton;
+    attached    |= ((uint16_t)1 << bit);
+    return pButton;
+  }
+
+  std::shared_ptr<MagicButton> getButton(uint8_t bit)
+  {
+    return (bit < MAX_BUTTONS) ? buttons[bit] : nullptr;
+  }
+
+  // Send every button's gestures to one queue, with the mux channel as the event id
+  void attachEventQueue(ButtonEventQueue *pQueue)
+  {
+    for (uint8_t bit(0); bit < MAX_BUTTONS; ++bit)
+    {
+      if (buttons[bit])
+      {
+        buttons[bit]->attachEventQueue(pQueue, bit);
+      }
+    }
+  }
+
+  // How long a button has to be down to show up in getHeldMask()
+  void setHoldTime(uint16_t ms) { holdTime = ms; }
+
+  // Call once per tick (1ms) from a single task
+  void service(uint32_t now)
+  {
+    if (scanMux)
+    {
+      pMux->service();
+    }
+
+    uint16_t raw(pMux->getReg());
+    debouncer.service(raw);
+
+    uint16_t down(debouncer.getState());
+    uint16_t pressed(debouncer.getPressed());
+    uint16_t held(0);
+    for (uint8_t bit(0); bit < MAX_BUTTONS; ++bit)
+    {
+      uint16_t mask((uint16_t)1 << bit);
+      if (!(attached & mask))
+      {
+        continue;
+      }
+
+      if (pressed & mask)
+      {
+        downSince[bit] = now;
+      }
+      else if ((down & mask) && ((uint32_t)(now - downSince[bit]) >= holdTime))
+      {
+        held |= mask;
+      }
+
+      buttons[bit]->serviceDebounced(down & mask, now);
+    }
+    heldMask.store(held, std::memory_order_release);
+  }
+
+  void service() { service(millis()); }
+
+  // Debounced state of every channel, bit n == channel n. Safe from any task.
+  uint16_t getDownMask(void) { return debouncer.getState(); }
+
+  // Attached buttons that have been down for at least the hold time. Safe from any task.
+  uint16_t getHeldMask(void) { return heldMask.load(std::memory_order_acquire); }
+
+  // Channels pressed / released since the last call. Safe from any task.
+  uint16_t takePressed(void)  { return debouncer.takePressed(); }
+  uint16_t takeReleased(void) { return debouncer.takeReleased(); }
+};
+
 #endif
@@ -19,6 +19,11 @@ private:
   static inline const TickType_t PATIENCE = 25;
   std::vector<std::shared_ptr<ControlObject>> pVirtualCtrls;
 
+  // What the active mode looked like the last time we checked, for hasChanged()
+  uint16_t  lastVal;
+  LockState lastLockState;
+  bool      changed;
+
   std::shared_ptr<ControlObject> getPtr(int8_t idx = -1)
   {
     if (idx == -1)
@@ -49,34 +54,39 @@ private:
     }
   }
 
+  void checkForChange();
+
 public:
 
   MultiModeCtrl(ADC_Object *inAdc,
                 uint8_t  numModes,
                 uint16_t topOfRange,
-                uint16_t defaultVal = 0):
-      numModes(numModes)
-  {
-    mutex = xSemaphoreCreateRecursiveMutex();
-    lock();
-    for (uint8_t mode = 0; mode < numModes; ++mode)
-    {
-      pVirtualCtrls.push_back(
-        std::make_shared<ControlObject>(
-          inAdc,
-          topOfRange + 1,
-          defaultVal));
-    }
-
-    activeIndex = 0;
-    unlock();
-  }
+                uint16_t defaultVal = 0,
+                SmoothingMode smoothing = SMOOTHING_STEADY):
+      MultiModeCtrl(std::shared_ptr<ADC_Object>(inAdc), numModes, topOfRange, defaultVal, smoothing)
+  { ; }
 
   MultiModeCtrl(std::shared_ptr<ADC_Object>inAdc,
+                uint8_t  numModes,
+                uint16_t topOfRange,
+                uint16_t defaultVal = 0,
+                SmoothingMode smoothing = SMOOTHING_STEADY):
+      MultiModeCtrl(makeCtrlFilter(inAdc, smoothing), numModes, topOfRange, defaultVal)
+  { ; }
+
+  // All modes share one filter: it's the same physical signal, so there's one history to
+  // keep, it's sampled once per tick however many modes there are, and switching modes
+  // doesn't throw it away
+  template <typename FilteredType,
+            typename = std::enable_if_t<std::is_base_of<FilteredADC, FilteredType>::value>>
+  MultiModeCtrl(std::shared_ptr<FilteredType>inSmoothedAdc,
                 uint8_t  numModes,
                 uint16_t topOfRange,
                 uint16_t defaultVal = 0):
-    numModes(numModes)
+    numModes(numModes),
+    lastVal(defaultVal),
+    lastLockState(STATE_UNLOCKED),
+    changed(false)
   {
     mutex = xSemaphoreCreateRecursiveMutex();
     lock();
@@ -84,14 +94,13 @@ public:
     {
       pVirtualCtrls.push_back(
         std::make_shared<ControlObject>(
-          inAdc,
+          inSmoothedAdc,
           topOfRange + 1,
           defaultVal));
     }
 
     activeIndex = 0;
     unlock();
-    // pActiveCtrl = pVirtualCtrls.at(0);
   }
 
   uint16_t read();
@@ -153,6 +162,10 @@ public:
   void service();
   uint8_t getNumModes();
 
+  // True if the active mode's value or lock state changed since the last call (including
+  // by switching modes). Lets a consumer skip controls that haven't moved.
+  bool hasChanged();
+
   void selectMode(uint8_t mode, bool reqUnlock = true)
   {
     if (!lock())
@@ -172,6 +185,7 @@ public:
       getPtr()->reqUnlock();
     }
 
+    checkForChange();
     unlock();
   }
 
@@ -187,11 +201,41 @@ public:
       getPtr(mode)->setLockVal(jamVal);
     }
 
+    checkForChange();
     unlock();
   }
 
   void setDefaults();
 
+  // Put a mode (default: the active one) on a scale; see ControlObject::setScale()
+  void setScale(uint16_t scaleMask,
+                uint8_t  root,
+                uint8_t  lowNote,
+                uint8_t  highNote,
+                int8_t   mode = -1)
+  {
+    if (!getPtr(mode))
+    {
+      return;
+    }
+    getPtr(mode)->setScale(scaleMask, root, lowNote, highNote);
+  }
+
+  // Note number for the active mode's current value
+  uint16_t readNote()
+  {
+    return getPtr()->readNote();
+  }
+
+  // See ControlObject::setServiceOnRead()
+  void setServiceOnRead(bool enable = true)
+  {
+    for (auto pCtrl : pVirtualCtrls)
+    {
+      pCtrl->setServiceOnRead(enable);
+    }
+  }
+
   void copySettings(uint8_t dest,
                     int8_t source = -1);
 
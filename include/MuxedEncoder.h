@@ -1,5 +1,6 @@
 #include "ClickEncoder.h"
 #include <DirectIO.h>
+#include <vector>
 
 
 class MuxedEncoder : public ClickEncoder
@@ -8,8 +9,22 @@ protected:
 
   static inline uint16_t _REGISTER = 0;
   static inline std::shared_ptr<HW_Mux> _SHARED_MUX = NULL;
+  static inline std::vector<MuxedEncoder *> _INSTANCES;
+
+  // Debounces every line on the mux at once for serviceAll(), so the buttons don't each
+  // lock themselves and the mux to fish out their own bit
+  static inline BankDebouncer _BUTTON_LINES{0};
+
+  // serviceAll() decodes every encoder on the mux in one pass, and all of them share one
+  // mutex so it only has to take it once per tick. A CD4067 has room for five encoders
+  // with buttons (eight without).
+  static const uint8_t MAX_ENCODERS = 8;
+  static inline QuadratureBank<MAX_ENCODERS> _DECODER;
+  static inline SemaphoreHandle_t _BANK_MUTEX = xSemaphoreCreateRecursiveMutex();
 
   const  uint16_t _BITMASK[2];
+  const  uint16_t _BTNMASK;
+  int8_t          _SLOT;       // Index in _DECODER, or -1 if it was full
 
   virtual bool readA() override;
   virtual bool readB() override;
@@ -19,6 +34,12 @@ public:
   MuxedEncoder(const uint8_t * const pinNums,
                uint8_t stepsPerNotch);
 
+  ~MuxedEncoder();
+
+  // Registered by address in _INSTANCES, so no copies
+  MuxedEncoder(const MuxedEncoder &) = delete;
+  MuxedEncoder &operator=(const MuxedEncoder &) = delete;
+
   static void setMux(HW_Mux *pMux);
 
   void init();
@@ -32,4 +53,12 @@ public:
   static void updateReg();
 
   void service() override;
+
+  // Services every MuxedEncoder and its button from one read of the mux register: one
+  // decoding pass over all of them, one lock, one debounce for all the buttons. Call
+  // updateReg() (or service the mux some other way) first. now: millis() at this tick.
+  // Use either this or service() on each encoder, not both: they track the pins separately,
+  // so the same edge would be counted twice.
+  static void serviceAll(uint32_t now);
+  static void serviceAll() { serviceAll(millis()); }
 };
@@ -0,0 +1,223 @@
+// ----------------------------------------------------------------------------
+// Table-driven quadrature decoding, for one encoder or a whole bank of them
+// ----------------------------------------------------------------------------
+#ifndef QUADRATURE_BANK_H
+#define QUADRATURE_BANK_H
+
+#include <Arduino.h>
+#include <atomic>
+
+// Direction of one quadrature transition, indexed by (previous AB << 2) | current AB.
+// No change and illegal two-bit jumps (00 <-> 11, 01 <-> 10) both count as 0.
+static const int8_t QUAD_TABLE[16] =
+{
+   0, -1,  1,  0,
+   1,  0,  0, -1,
+  -1,  0,  0,  1,
+   0,  1, -1,  0
+};
+
+// Both pins changed since the last look (00 <-> 11, 01 <-> 10): the state in between was
+// missed, usually because the encoder was polled late
+inline bool quadSkipped(uint8_t prev, uint8_t curr)
+{
+  return ((prev ^ curr) & 0b11) == 0b11;
+}
+
+// Decode the move from prev to curr (both AB, A in bit 1). A one-step move comes straight
+// from QUAD_TABLE and becomes the new lastDir. A skipped move could have gone either way,
+// so assume the encoder kept turning the way it last turned: two steps in lastDir, or
+// nothing if lastDir is still 0.
+inline int8_t quadDecode(uint8_t prev, uint8_t curr, int8_t &lastDir)
+{
+  if (quadSkipped(prev, curr))
+  {
+    return 2 * lastDir;
+  }
+
+  int8_t ret(QUAD_TABLE[(prev << 2) | curr]);
+  if (ret)
+  {
+    lastDir = ret;
+  }
+
+  return ret;
+}
+
+// Missed-state counts for one encoder. skipped: moves where a state went missing;
+// unrecovered: the ones among them that couldn't be counted, for want of a direction.
+// Steadily climbing counts mean the encoder isn't being read often enough.
+struct QuadErrors
+{
+  uint32_t skipped;
+  uint32_t unrecovered;
+};
+
+
+// Up to 16 encoders whose A/B lines all show up in one word (e.g. HW_Mux::getReg(), a
+// shift register, a GPIO port read), decoded together in one pass over a few small arrays.
+// Use service() and readPosition() to have the bank count detents itself, or decode() to
+// get each encoder's transitions and count them your own way (see MuxedEncoder).
+//
+//  N:        number of encoders (slots, if they're attached one at a time)
+//  abBits:   bit positions in the word, A0, B0, A1, B1, ...
+//  steps:    transitions per detent
+template <uint8_t N>
+class QuadratureBank
+{
+  static_assert((N > 0) && (N <= 16), "QuadratureBank handles 1 to 16 encoders");
+
+  uint8_t  bitA[N];
+  uint8_t  bitB[N];
+  uint8_t  steps;
+  uint16_t attached;
+
+  uint8_t lastEncoded[N];
+  int8_t  delta[N];       // Transitions since the last detent
+  int8_t  lastDir[N];     // Direction of the last one-step move, for quadDecode()
+
+  std::atomic<int16_t>  position[N];
+  std::atomic<uint32_t> skipped[N];
+  std::atomic<uint32_t> unrecovered[N];
+
+  uint8_t encode(uint8_t n, uint32_t word) const
+  {
+    return (uint8_t)((((word >> bitA[n]) & 1) << 1) | ((word >> bitB[n]) & 1));
+  }
+
+public:
+
+  // Nothing attached yet; see attach()
+  QuadratureBank():
+    steps(4),
+    attached(0)
+  {
+    for (uint8_t n(0); n < N; ++n)
+    {
+      attach(n, 0, 0);
+      detach(n);
+    }
+  }
+
+  // initialWord: a first read, so whatever the encoders are sitting on isn't a move
+  QuadratureBank(const uint8_t *abBits, uint8_t stepsPerNotch = 4, uint32_t initialWord = 0):
+    steps(stepsPerNotch),
+    attached(0)
+  {
+    for (uint8_t n(0); n < N; ++n)
+    {
+      attach(n, abBits[2 * n], abBits[2 * n + 1], initialWord);
+    }
+  }
+
+  // (Re)start decoding encoder n from bits a and b of the word, with everything it had
+  // counted cleared. Not safe against a concurrent service() / decode().
+  void attach(uint8_t n, uint8_t a, uint8_t b, uint32_t word = 0)
+  {
+    if (n >= N)
+    {
+      return;
+    }
+
+    bitA[n]        = a;
+    bitB[n]        = b;
+    lastEncoded[n] = encode(n, word);
+    delta[n]       = 0;
+    lastDir[n]     = 0;
+    position[n].store(0, std::memory_order_relaxed);
+    skipped[n].store(0, std::memory_order_relaxed);
+    unrecovered[n].store(0, std::memory_order_relaxed);
+    attached |= ((uint16_t)1 << n);
+  }
+
+  void detach(uint8_t n)
+  {
+    if (n < N)
+    {
+      attached &= ~((uint16_t)1 << n);
+    }
+  }
+
+  bool isAttached(uint8_t n) const { return (n < N) && (attached & ((uint16_t)1 << n)); }
+
+  // Decode one word without counting detents: transitions[n] gets encoder n's move since
+  // the last word (skipped states recovered as in quadDecode()) and is left alone for the
+  // encoders that didn't move. Returns a mask of the ones that did. Single task only.
+  uint16_t decode(uint32_t word, int8_t *transitions)
+  {
+    uint16_t moved(0);
+    for (uint8_t n(0); n < N; ++n)
+    {
+      uint8_t encoded(encode(n, word));
+      if (!(attached & ((uint16_t)1 << n)) || (encoded == lastEncoded[n]))
+      {
+        continue;
+      }
+
+      if (quadSkipped(lastEncoded[n], encoded))
+      {
+        skipped[n].fetch_add(1, std::memory_order_relaxed);
+        if (!lastDir[n])
+        {
+          unrecovered[n].fetch_add(1, std::memory_order_relaxed);
+        }
+      }
+
+      transitions[n] = quadDecode(lastEncoded[n], encoded, lastDir[n]);
+      lastEncoded[n] = encoded;
+      moved         |= ((uint16_t)1 << n);
+    }
+
+    return moved;
+  }
+
+  // Call once per tick from a single task
+  void service(uint32_t word)
+  {
+    int8_t   transitions[N];
+    uint16_t moved(decode(word, transitions));
+    while (moved)
+    {
+      uint8_t n(__builtin_ctz(moved));
+      moved &= moved - 1;
+
+      delta[n] += transitions[n];
+
+      int16_t detents(0);
+      while (delta[n] >= (int8_t)steps)
+      {
+        delta[n] -= steps;
+        ++detents;
+      }
+
+      while (delta[n] <= -(int8_t)steps)
+      {
+        delta[n] += steps;
+        --detents;
+      }
+
+      if (detents)
+      {
+        position[n].fetch_add(detents, std::memory_order_release);
+      }
+    }
+  }
+
+  // Detents counted so far. Safe from any task.
+  int16_t readPosition(uint8_t n) const { return position[n].load(std::memory_order_acquire); }
+
+  // Missed-state counts for encoder n since startup or the last reset. Safe from any task.
+  QuadErrors readErrors(uint8_t n, bool reset = false)
+  {
+    if (reset)
+    {
+      return { skipped[n].exchange(0, std::memory_order_relaxed),
+               unrecovered[n].exchange(0, std::memory_order_relaxed) };
+    }
+
+    return { skipped[n].load(std::memory_order_relaxed),
+             unrecovered[n].load(std::memory_order_relaxed) };
+  }
+};
+
+#endif
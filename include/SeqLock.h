@@ -0,0 +1,71 @@
+////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Single-writer, many-reader publication of small values without a mutex
+//
+#pragma once
+
+#include <Arduino.h>
+#include <atomic>
+
+////////////////////////////////////////////////////////////////////////////////////////////
+// Sequence-counted double buffer. The writer (e.g. the 1 kHz service task) fills the slot
+// readers *aren't* looking at and then bumps the sequence number, so it never waits on a
+// reader. A reader copies the current slot and retries if the sequence moved at all
+// mid-copy: once one more value is published, the next write goes into the very slot it's
+// copying. A write that's still in progress never makes a reader retry (it's filling the
+// other slot), so a high-priority reader can't spin on a preempted writer -- important on a
+// single core. It only goes around again when a publish actually completed under it.
+//
+//  T: anything trivially copyable (a sample, a running sum + count, a whole snapshot...)
+//
+//  write:       publish a new value (ONE writer only)
+//  read:        get the most recently published value, consistent as a whole
+//  getSequence: number of values published so far
+template <typename T>
+class SeqLock
+{
+  T slots[2];
+  std::atomic<uint32_t> sequence;
+
+public:
+
+  SeqLock():
+      SeqLock(T())
+  { ; }
+
+  explicit SeqLock(const T &initVal):
+      slots{initVal, initVal},
+      sequence(0)
+  { ; }
+
+  void write(const T &val)
+  {
+    uint32_t next(sequence.load(std::memory_order_relaxed) + 1);
+
+    // Keep the new slot contents from showing up ahead of the last sequence bump
+    std::atomic_thread_fence(std::memory_order_release);
+    slots[next & 1] = val;
+    sequence.store(next, std::memory_order_release);
+  }
+
+  T read(void) const
+  {
+    T ret;
+    uint32_t before;
+    uint32_t after;
+    do
+    {
+      before = sequence.load(std::memory_order_acquire);
+      ret    = slots[before & 1];
+      std::atomic_thread_fence(std::memory_order_acquire);
+      after  = sequence.load(std::memory_order_relaxed);
+    } while (after != before);
+
+    return ret;
+  }
+
+  uint32_t getSequence(void) const
+  {
+    return sequence.load(std::memory_order_acquire);
+  }
+};
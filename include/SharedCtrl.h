@@ -9,6 +9,7 @@
 
 #include <Arduino.h>
 #include "MCP_ADC.h"
+#include <atomic>
 #include <memory>
 #include <vector>
 #include <RatFuncs.h>
@@ -40,11 +41,16 @@ protected:
   const    uint8_t  ch;
   const    int16_t  adcMax;
 
+  // The sample window is only touched inside windowLock (a spinlock, so it also keeps out
+  // a service() call on the other core); readers only ever look at the atomics
            uint8_t  buffSize;
-  volatile int16_t  buff[MAX_BUFFER_SIZE];
-  volatile uint8_t  sampleIdx;
-           int64_t  sum_;
-  volatile bool bufferReady;
+           int16_t  buff[MAX_BUFFER_SIZE];
+           uint8_t  sampleIdx;
+           int32_t  runningSum;  // Sum of the last buffSize samples
+  portMUX_TYPE      windowLock = portMUX_INITIALIZER_UNLOCKED;
+
+  std::atomic<int16_t> mean_;    // runningSum / buffSize, as of the last service()
+  std::atomic<bool>    bufferReady;
 
 public:
 
@@ -71,12 +77,13 @@ class LockingCtrl
 {
 protected:
   std::shared_ptr<HardwareCtrl> pHwCtrl_;
-  volatile LockState state_;
+  std::atomic<LockState> state_;
   int16_t min_;
   int16_t max_;
-  int16_t lockVal_;
+  std::atomic<int16_t> lockVal_;
   uint16_t threshInt_;
   LockState setLockState_(LockState state);
+  bool      tryUnlock_();
 
 public:
 
@@ -105,6 +112,12 @@ public:
     int16_t inVal,
     bool createLocked = true);
 
+  // Shares an existing sampler, e.g. with the other modes on the same channel
+  LockingCtrl(
+    std::shared_ptr<HardwareCtrl> pHwCtrl,
+    int16_t inVal,
+    bool createLocked = true);
+
   int16_t           getMin();
   int16_t           getMax();
   int16_t           getLockVal();
@@ -142,6 +155,13 @@ public:
     int16_t min = 0,
     bool    createLocked = true);
 
+  VirtualCtrl(
+    std::shared_ptr<HardwareCtrl> pHwCtrl,
+    int16_t inSlice,
+    int16_t max,
+    int16_t min = 0,
+    bool    createLocked = true);
+
     int16_t peekMeasuredVal();
     int16_t read();
     void    setMaxAndMin(int16_t max,
@@ -0,0 +1,81 @@
+////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Fixed-capacity single-producer, single-consumer ring buffer; no locks, no heap
+//
+#pragma once
+
+#include <Arduino.h>
+#include <atomic>
+
+////////////////////////////////////////////////////////////////////////////////////////////
+// One task (or ISR) pushes, one task pops, and neither ever waits on the other. When the
+// ring is full, push() drops the new item and counts it rather than overwriting something
+// the consumer hasn't seen.
+//
+//  T:        anything trivially copyable
+//  Capacity: power of two
+//
+//  push:        add an item (producer only); false if the ring was full
+//  pop:         take the oldest item (consumer only); false if there wasn't one
+//  available:   number of items waiting
+//  takeDropped: number of items dropped since the last call
+template <typename T, uint16_t Capacity>
+class SpscQueue
+{
+  static_assert((Capacity > 0) && ((Capacity & (Capacity - 1)) == 0),
+                "SpscQueue capacity must be a power of two");
+
+  static constexpr uint32_t MASK = Capacity - 1;
+
+  T items[Capacity];
+
+  // Free-running; only the producer writes head and only the consumer writes tail
+  std::atomic<uint32_t> head;
+  std::atomic<uint32_t> tail;
+  std::atomic<uint32_t> dropped;
+
+public:
+
+  SpscQueue():
+    head(0),
+    tail(0),
+    dropped(0)
+  { ; }
+
+  bool push(const T &item)
+  {
+    uint32_t h(head.load(std::memory_order_relaxed));
+    if (h - tail.load(std::memory_order_acquire) >= Capacity)
+    {
+      dropped.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+
+    items[h & MASK] = item;
+    head.store(h + 1, std::memory_order_release);
+    return true;
+  }
+
+  bool pop(T &item)
+  {
+    uint32_t t(tail.load(std::memory_order_relaxed));
+    if (t == head.load(std::memory_order_acquire))
+    {
+      return false;
+    }
+
+    item = items[t & MASK];
+    tail.store(t + 1, std::memory_order_release);
+    return true;
+  }
+
+  uint16_t available(void) const
+  {
+    return (uint16_t)(head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire));
+  }
+
+  uint32_t takeDropped(void)
+  {
+    return dropped.exchange(0, std::memory_order_relaxed);
+  }
+};
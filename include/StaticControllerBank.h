@@ -0,0 +1,409 @@
+////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Fixed-size alternative to ControllerBank. The control count, mode count, ADC backend and
+// filter are template parameters and every bit of state lives in arrays laid out at compile
+// time (one array per field, indexed by control), so there's no heap use at all, the RAM
+// budget is known at link time, and service() walks contiguous memory.
+//
+#pragma once
+
+#include <Arduino.h>
+#include <ControllerBank.h>
+#include <freertos/semphr.h>
+#include <utility>
+
+////////////////////////////////////////////////////////////////////////////////////////////
+// ADC backends. All a backend needs is
+//
+//  void scan(uint16_t *raw)    fill in one reading per control, in control order
+//
+
+// Channels of an MCP ADC that you own (e.g. a global MCP3208)
+//
+//  adc:        the ADC
+//  channelMap: which ADC channel each control reads; defaults to control n <-> channel n
+template <uint8_t Controls>
+class MCP_Backend
+{
+  MCP_ADC &adc;
+  uint8_t  channels[Controls];
+
+public:
+
+  MCP_Backend(MCP_ADC &adc, const uint8_t *channelMap = nullptr):
+    adc(adc)
+  {
+    for (uint8_t n(0); n < Controls; ++n)
+    {
+      channels[n] = channelMap ? channelMap[n] : n;
+    }
+  }
+
+  void scan(uint16_t *raw)
+  {
+    for (uint8_t n(0); n < Controls; ++n)
+    {
+      raw[n] = adc.analogRead(channels[n]);
+    }
+  }
+};
+
+// ADC-enabled ESP32 pins
+//
+//  pins: one pin per control
+template <uint8_t Controls>
+class ESP32_Backend
+{
+  ESP32AnalogRead adcs[Controls];
+
+public:
+
+  ESP32_Backend(const uint8_t *pins)
+  {
+    for (uint8_t n(0); n < Controls; ++n)
+    {
+      pinMode(pins[n], INPUT);
+      adcs[n].attach(pins[n]);
+    }
+  }
+
+  void scan(uint16_t *raw)
+  {
+    for (uint8_t n(0); n < Controls; ++n)
+    {
+      raw[n] = adcs[n].readRaw();
+    }
+  }
+};
+
+
+////////////////////////////////////////////////////////////////////////////////////////////
+// Controls: number of physical controls (up to MAX_BANK_CONTROLS)
+// Modes:    number of modes / pages / virtual controller scenes
+// Backend:  where readings come from, e.g. MCP_Backend<8>; constructed from the trailing
+//           constructor arguments
+// Filter:   smoothing policy from ADC_Filters.h, one instance per control
+//
+// Selecting a scene locks every control at that scene's value; with reqUnlock, each control
+// picks up again once the hardware reading lands in that value's slice. Once unlocked, a
+// control only moves when the reading is [hysteresis] counts into a neighbouring slice: a
+// flat band of DEFAULT_THRESHOLD of the raw span, capped just under half a slice. That's
+// simpler than ControllerBank's QuantTable bands, so the two can settle one value apart
+// near a boundary.
+template <uint8_t Controls,
+          uint8_t Modes,
+          typename Backend,
+          typename Filter = DefaultCtrlFilter>
+class StaticControllerBank
+{
+  static_assert(Controls <= MAX_BANK_CONTROLS, "Too many controls for one bank");
+  static_assert(Modes > 0, "A bank needs at least one mode");
+
+  static inline const uint32_t ALL_CONTROLS = (Controls == 32) ? 0xFFFFFFFF
+                                                               : (((uint32_t)1 << Controls) - 1);
+
+  Backend backend;
+
+  StaticSemaphore_t mutexBuffer;
+  SemaphoreHandle_t mutex;
+  static inline const TickType_t PATIENCE = 10;
+
+  uint8_t currentMode;
+
+  // Per-control sampling state
+  uint16_t raw[Controls];
+  Filter   filters[Controls];
+
+  // Per-control range: raw calibration, number of control values, and the fixed-point
+  // constants derived from them so that service() never divides
+  uint16_t rawMin[Controls];
+  uint32_t rawSpan[Controls];      // Up to 65536, for a 0..65535 range
+  uint16_t numVals[Controls];
+  uint32_t sliceScale[Controls];   // numVals / rawSpan, Q16
+  uint32_t sliceWidth[Controls];   // rawSpan / numVals, Q8
+  uint16_t hysteresis[Controls];   // Raw counts past a boundary before we move
+
+  // Per-mode lock values; the active mode's row tracks unlocked controls
+  uint16_t lockVals[Modes][Controls];
+
+  // Active mode lock states, one bit per control; unlocked == in neither mask
+  uint32_t lockedMask;
+  uint32_t pendingMask;   // STATE_UNLOCK_REQUESTED
+
+  BankSnapshot          working;
+  SeqLock<BankSnapshot> published;
+  BankChangeTracker     changes;
+
+  bool lock()
+  {
+    return (pdTRUE == xSemaphoreTakeRecursive(mutex, PATIENCE));
+  }
+
+  void unlock()
+  {
+    xSemaphoreGiveRecursive(mutex);
+  }
+
+  uint16_t sliceOf(uint8_t n, uint16_t rawVal)
+  {
+    if (rawVal <= rawMin[n])
+    {
+      return 0;
+    }
+
+    // Past the top of the range is the top value (and keeps the multiply from overflowing)
+    uint32_t offset(rawVal - rawMin[n]);
+    if (offset >= rawSpan[n])
+    {
+      return numVals[n] - 1;
+    }
+
+    uint32_t slice((offset * sliceScale[n]) >> 16);
+    return (slice >= numVals[n]) ? numVals[n] - 1 : (uint16_t)slice;
+  }
+
+  uint16_t sliceBase(uint8_t n, uint16_t slice)
+  {
+    return rawMin[n] + (uint16_t)(((uint32_t)slice * sliceWidth[n]) >> 8);
+  }
+
+  // Only call with the mutex held
+  void publishSnapshot()
+  {
+    uint32_t prevLocks(working.lockMask);
+
+    ++working.sequence;
+    working.lockMask    = (lockedMask | pendingMask);
+    working.changedVals = 0;
+    for (uint8_t n(0); n < Controls; ++n)
+    {
+      if (working.vals[n] != lockVals[currentMode][n])
+      {
+        working.changedVals |= ((uint32_t)1 << n);
+        working.vals[n] = lockVals[currentMode][n];
+      }
+    }
+    working.changedLocks = working.lockMask ^ prevLocks;
+
+    published.write(working);
+    changes.record(working);
+  }
+
+public:
+
+  template <typename... BackendArgs>
+  StaticControllerBank(uint16_t topOfRange, BackendArgs&&... backendArgs):
+    backend(std::forward<BackendArgs>(backendArgs)...),
+    mutex(xSemaphoreCreateRecursiveMutexStatic(&mutexBuffer)),
+    currentMode(0),
+    lockedMask(ALL_CONTROLS),
+    pendingMask(0),
+    working{}
+  {
+    for (uint8_t n(0); n < Controls; ++n)
+    {
+      raw[n] = 0;
+      filters[n].reset();
+      setRange(n, 0, 4095, topOfRange);
+      for (uint8_t mode(0); mode < Modes; ++mode)
+      {
+        lockVals[mode][n] = 0;
+      }
+    }
+    publishSnapshot();
+  }
+
+  // Raw ADC calibration for one control, and (optionally) the highest control value it
+  // should return
+  void setRange(uint8_t controlIdx, uint16_t min, uint16_t max, int32_t topOfRange = -1)
+  {
+    if ((controlIdx >= Controls) || (min > max) || (topOfRange > 0xFFFE))
+    {
+      return;
+    }
+
+    if (!lock())
+    {
+      return;
+    }
+
+    rawMin[controlIdx]  = min;
+    rawSpan[controlIdx] = (uint32_t)max + 1 - min;
+    if (topOfRange >= 0)
+    {
+      numVals[controlIdx] = topOfRange + 1;
+    }
+
+    sliceScale[controlIdx] = ((uint32_t)numVals[controlIdx] << 16) / rawSpan[controlIdx];
+    sliceWidth[controlIdx] = (rawSpan[controlIdx] << 8) / numVals[controlIdx];
+
+    // Never more than half a slice, or a reading could never get far enough in to move
+    uint32_t halfSlice(sliceWidth[controlIdx] >> 9);
+    uint32_t hyst((uint32_t)(rawSpan[controlIdx] * DEFAULT_THRESHOLD));
+    hysteresis[controlIdx] = (hyst < halfSlice) ? hyst : ((halfSlice > 0) ? halfSlice - 1 : 0);
+    unlock();
+  }
+
+  // Sample, filter, and track every control, then publish a snapshot (and call the change
+  // callback, if anything changed)
+  void service()
+  {
+    backend.scan(raw);
+
+    if (!lock())
+    {
+      return;
+    }
+
+    uint16_t *vals(lockVals[currentMode]);
+    for (uint8_t n(0); n < Controls; ++n)
+    {
+      filters[n].push(raw[n]);
+      uint32_t bit((uint32_t)1 << n);
+      if (lockedMask & bit)
+      {
+        continue;
+      }
+
+      uint16_t rawVal(filters[n].value());
+      uint16_t slice(sliceOf(n, rawVal));
+      if (pendingMask & bit)
+      {
+        // Pick the control back up once the hardware gets to where we left it
+        if (slice != vals[n])
+        {
+          continue;
+        }
+        pendingMask &= ~bit;
+      }
+
+      // Make sure you're part way into the neighbouring value before switching; if you're
+      // not that far into this slice yet, stop one short of it
+      if (slice > vals[n])
+      {
+        if (rawVal < sliceBase(n, slice) + hysteresis[n])
+        {
+          --slice;
+        }
+        vals[n] = slice;
+      }
+      else if (slice < vals[n])
+      {
+        if ((slice + 1 < numVals[n]) && (rawVal + hysteresis[n] >= sliceBase(n, slice + 1)))
+        {
+          ++slice;
+        }
+        vals[n] = slice;
+      }
+    }
+
+    publishSnapshot();
+    unlock();
+
+    changes.notify();
+  }
+
+  // See ControllerBank::setChangeCallback()
+  void setChangeCallback(BankChangeCallback cb, void *pArg = nullptr)
+  {
+    if (!lock())
+    {
+      return;
+    }
+
+    changes.setCallback(cb, pArg);
+    unlock();
+  }
+
+  // See ControllerBank::takeChangedVals()
+  uint32_t takeChangedVals(void)
+  {
+    return changes.takeChangedVals();
+  }
+
+  uint32_t takeChangedLocks(void)
+  {
+    return changes.takeChangedLocks();
+  }
+
+  void saveScene(void)
+  {
+    selectScene(currentMode);
+  }
+
+  void selectScene(uint8_t sceneIdx, bool reqUnlock = true)
+  {
+    if (!lock())
+    {
+      return;
+    }
+
+    currentMode = (sceneIdx < Modes) ? sceneIdx : Modes - 1;
+    lockedMask  = reqUnlock ? 0 : ALL_CONTROLS;
+    pendingMask = reqUnlock ? ALL_CONTROLS : 0;
+    publishSnapshot();
+    unlock();
+
+    changes.notify();
+  }
+
+  uint8_t getScene(void) { return currentMode; }
+
+  // Overwrite the stored value of one control in one mode (default: the active one)
+  void setLockVal(uint8_t controlIdx, uint16_t val, int8_t mode = -1)
+  {
+    if ((controlIdx >= Controls) || (mode >= (int16_t)Modes))
+    {
+      return;
+    }
+
+    if (!lock())
+    {
+      return;
+    }
+
+    uint8_t m((mode < 0) ? currentMode : mode);
+    lockVals[m][controlIdx] = val;
+    if ((m == currentMode) && !(lockedMask & ((uint32_t)1 << controlIdx)))
+    {
+      pendingMask |= ((uint32_t)1 << controlIdx);
+    }
+    publishSnapshot();
+    unlock();
+
+    changes.notify();
+  }
+
+  uint16_t getLockVal(uint8_t controlIdx, int8_t mode = -1)
+  {
+    if ((controlIdx >= Controls) || (mode >= (int16_t)Modes))
+    {
+      return 0;
+    }
+
+    if (!lock())
+    {
+      return 0;
+    }
+
+    uint16_t ret(lockVals[(mode < 0) ? currentMode : mode][controlIdx]);
+    unlock();
+    return ret;
+  }
+
+  // Same lock-free read side as ControllerBank
+  BankSnapshot getSnapshot(void)
+  {
+    return published.read();
+  }
+
+  uint16_t read(uint8_t controlIdx)
+  {
+    return published.read().vals[controlIdx];
+  }
+
+  bool isLocked(uint8_t controlIdx)
+  {
+    return (published.read().lockMask >> controlIdx) & 1;
+  }
+};
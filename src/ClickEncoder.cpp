@@ -11,11 +11,18 @@
 #include <DirectIO.h>
 
 // ----------------------------------------------------------------------------
-// Acceleration configuration (for 1000Hz calls to ::service())
+// isrState packing (see ClickEncoder.h)
 //
-const uint16_t ENC_ACCEL_TOP (3072);  // max. acceleration: *12 (val >> 8)
-const uint8_t  ENC_ACCEL_INC (25);
-const uint8_t  ENC_ACCEL_DEC (2);
+static inline uint32_t packIsrState(uint8_t encoded, int8_t delta, int16_t position, int8_t dir)
+{
+  return ((uint32_t)(dir + 1) << 26) | ((uint32_t)encoded << 24)
+       | ((uint32_t)(uint8_t)delta << 16) | (uint16_t)position;
+}
+
+static inline int16_t isrPosition(uint32_t state) { return (int16_t)(state & 0xFFFF); }
+static inline int8_t  isrDelta(uint32_t state)    { return (int8_t)((state >> 16) & 0xFF); }
+static inline uint8_t isrEncoded(uint32_t state)  { return (uint8_t)((state >> 24) & 0b11); }
+static inline int8_t  isrDir(uint32_t state)      { return (int8_t)((state >> 26) & 0b11) - 1; }
 
 // ----------------------------------------------------------------------------
 
@@ -29,10 +36,18 @@ ClickEncoder::ClickEncoder(int8_t A,
    position(0),
    delta(0),
    acceleration(0),
+   lastDetentMs(0),
+   accelCurve(((uint32_t)ENC_ACCEL_TOP << 16) | ((uint32_t)ENC_ACCEL_INC << 8) | ENC_ACCEL_DEC),
+   accelReset(false),
    steps(stepsPerNotch),
    pinA(A),
    pinB(B),
    lastEncoded(0),
+   lastDir(0),
+   isrState(0),
+   interruptMode(false),
+   skippedCount(0),
+   unrecoveredCount(0),
    activeLow(usePulllResistor),
    encoderMutex(xSemaphoreCreateRecursiveMutex())
 {
@@ -45,6 +60,7 @@ ClickEncoder::ClickEncoder(int8_t A,
 
     MSB = readA();
     LSB = readB();
+    lastEncoded = (MSB << 1) | LSB;
   }
   else
   {
@@ -58,99 +74,239 @@ ClickEncoder::ClickEncoder(int8_t A,
 //
 void ClickEncoder::service(void)
 {
-  lock();
-  long encoded = 0;
-  long tmpMSB  = (long)readA();
-  long tmpLSB  = (long)readB();
-
-  // TODO: we're mimicking the hardware interrupts here, so we need to handle the first three
-  // lines for one bit then run the equivalent of the ISR once *BEFORE* we do the same thing
-  // for the other pin. If you want, put the redundant stuff in its own function so you can
-  // call it without disturbing the other logic, since the sequence here is very important
-  if (MSB != tmpMSB)
-  {
-    MSB      = tmpMSB;
-    encoded  = (MSB << 1) | LSB;
-    long sum = (lastEncoded << 2) | encoded;  // Add it to the previous encoded value
-    switch(sum)
+  // Checked and decoded under the mutex, so enableInterrupts() can't seed the ISR and
+  // attach it between this poll's check and its decode (and count the same edge twice)
+  if (lock())
+  {
+    if (!interruptMode.load(std::memory_order_relaxed))
     {
-      case 0b1101:
-      case 0b0100:
-      case 0b0010:
-      case 0b1011:
-        ++delta;
-        break;
-
-      case 0b1110:
-      case 0b0111:
-      case 0b0001:
-      case 0b1000:
-        --delta;
-        break;
-
-      default:
-        break;
+      decode(readA(), readB());
     }
+    unlock();
+  }
 
-    int16_t oldPos = position;
-    while (delta >= (int16_t)steps)
-    {
-      delta -= (int16_t)steps;
-      ++position;
-    }
+  hwButton->service();
+}
 
-    while (delta <= -(int16_t)steps)
-    {
-      delta += (int16_t)steps;
-      --position;
-    }
 
+// ----------------------------------------------------------------------------
+// Pin-change ISR for interrupt mode. Both pins' interrupts are dispatched by the one GPIO
+// ISR on the core that attached them, so they never overlap and this is the only writer
+// of isrState; a plain load and store is all it takes.
+//
+void IRAM_ATTR ClickEncoder::isrPinChange(void *pArg)
+{
+  ClickEncoder *pEnc(static_cast<ClickEncoder *>(pArg));
+
+  uint8_t  encoded(((directRead(pEnc->pinA) ^ pEnc->activeLow) << 1)
+                  | (directRead(pEnc->pinB) ^ pEnc->activeLow));
+  uint32_t state(pEnc->isrState.load(std::memory_order_relaxed));
+  uint8_t  prev(isrEncoded(state));
+  if (encoded == prev)
+  {
+    return;
+  }
+
+  int16_t pos(isrPosition(state));
+  int8_t  dir(isrDir(state));
+  int8_t  delta(isrDelta(state) + pEnc->decodeStep(prev, encoded, dir));
+  while (delta >= (int8_t)pEnc->steps)
+  {
+    delta -= pEnc->steps;
+    pos   += pEnc->detentSize();
+  }
+
+  while (delta <= -(int8_t)pEnc->steps)
+  {
+    delta += pEnc->steps;
+    pos   -= pEnc->detentSize();
+  }
+
+  pEnc->isrState.store(packIsrState(encoded, delta, pos, dir), std::memory_order_release);
+}
+
+
+// ----------------------------------------------------------------------------
+// Hand decoding over to the pin-change interrupts (or take it back). Whatever the encoder
+// had counted so far carries over either way.
+//
+bool ClickEncoder::enableInterrupts(bool enable)
+{
+  if ((int8_t)pinA == -1)
+  {
+    return false;
+  }
+
+  if (!lock())
+  {
+    return false;
+  }
+
+  if (enable && !interruptMode.load(std::memory_order_relaxed))
+  {
+    uint8_t encoded((readA() << 1) | readB());
+    isrState.store(packIsrState(encoded, delta, position, lastDir), std::memory_order_release);
+    interruptMode.store(true, std::memory_order_release);
+
+    attachInterruptArg(digitalPinToInterrupt(pinA), isrPinChange, this, CHANGE);
+    attachInterruptArg(digitalPinToInterrupt(pinB), isrPinChange, this, CHANGE);
+  }
+  else if (!enable && interruptMode.load(std::memory_order_relaxed))
+  {
+    detachInterrupt(digitalPinToInterrupt(pinA));
+    detachInterrupt(digitalPinToInterrupt(pinB));
+
+    uint32_t state(isrState.load(std::memory_order_acquire));
+    position    = isrPosition(state);
+    delta       = isrDelta(state);
+    lastEncoded = isrEncoded(state);
+    lastDir     = isrDir(state);
+    interruptMode.store(false, std::memory_order_release);
+  }
+  unlock();
+
+  return true;
+}
+
+
+// ----------------------------------------------------------------------------
+// Count whatever the pins did since the last look. If both pins changed, we were too slow
+// and missed a state; decodeStep() guesses which way it went.
+//
+void ClickEncoder::decode(bool a, bool b)
+{
+  if (!lock())
+  {
+    return;
+  }
+
+  // The ISR owns decoding now
+  if (interruptMode.load(std::memory_order_relaxed))
+  {
+    unlock();
+    return;
+  }
+
+  long encoded = ((long)a << 1) | (long)b;
+  if (encoded != lastEncoded)
+  {
+    MSB = a;
+    LSB = b;
+    addTransitions(decodeStep(lastEncoded, encoded, lastDir));
     lastEncoded = encoded;
   }
+  unlock();
+}
+
 
-  if (LSB != tmpLSB)
+// ----------------------------------------------------------------------------
+// quadDecode(), plus keeping count of skipped states. Touches only atomics and [dir], so
+// it's fine from the ISR too.
+//
+int8_t IRAM_ATTR ClickEncoder::decodeStep(uint8_t prev, uint8_t curr, int8_t &dir)
+{
+  if (quadSkipped(prev, curr))
   {
-    LSB      = tmpLSB;
-    encoded  = (MSB << 1) | LSB;
-    long sum = (lastEncoded << 2) | encoded;  // Add it to the previous encoded value
-    switch(sum)
+    skippedCount.fetch_add(1, std::memory_order_relaxed);
+    if (!dir)
     {
-      case 0b1101:
-      case 0b0100:
-      case 0b0010:
-      case 0b1011:
-        ++delta;
-        break;
-
-      case 0b1110:
-      case 0b0111:
-      case 0b0001:
-      case 0b1000:
-        --delta;
-        break;
-
-      default:
-        break;
+      unrecoveredCount.fetch_add(1, std::memory_order_relaxed);
     }
+  }
 
-    int16_t oldPos = position;
-    while (delta >= (int16_t)steps)
-    {
-      delta -= (int16_t)steps;
-      ++position;
-    }
+  return quadDecode(prev, curr, dir);
+}
 
-    while (delta <= -(int16_t)steps)
-    {
-      delta += (int16_t)steps;
-      --position;
-    }
 
-    lastEncoded = encoded;
+// ----------------------------------------------------------------------------
+// Skipped-state counts; safe from any task
+//
+QuadErrors ClickEncoder::readErrors(bool reset)
+{
+  if (reset)
+  {
+    return { skippedCount.exchange(0, std::memory_order_relaxed),
+             unrecoveredCount.exchange(0, std::memory_order_relaxed) };
   }
 
-  unlock();
-  hwButton->service();
+  return { skippedCount.load(std::memory_order_relaxed),
+           unrecoveredCount.load(std::memory_order_relaxed) };
+}
+
+
+// ----------------------------------------------------------------------------
+// Accumulate transitions and turn every [steps] of them into a detent. Caller must hold
+// the mutex.
+//
+void ClickEncoder::addTransitions(int8_t transitions)
+{
+  int16_t transitionsLeft(delta + transitions);
+  int16_t newPosition(position);
+  while (transitionsLeft >= (int16_t)steps)
+  {
+    transitionsLeft -= (int16_t)steps;
+    newPosition     += detentSize();
+  }
+
+  while (transitionsLeft <= -(int16_t)steps)
+  {
+    transitionsLeft += (int16_t)steps;
+    newPosition     -= detentSize();
+  }
+
+  delta    = transitionsLeft;
+  position = newPosition;
+}
+
+
+// ----------------------------------------------------------------------------
+// How far one detent moves the position. With acceleration on, every transition adds inc
+// (so steps * inc per detent) and every millisecond since the last detent takes away dec;
+// with the defaults it starts building at about 20 detents/s and a fast spin tops out at
+// (1 + top / 256) per detent, while a slow one stays at 1. Caller must hold the mutex (or
+// be the ISR, in interrupt mode).
+//
+int16_t IRAM_ATTR ClickEncoder::detentSize(void)
+{
+  if (!accelerationEnabled.load(std::memory_order_relaxed))
+  {
+    return 1;
+  }
+
+  uint32_t curve(accelCurve.load(std::memory_order_acquire));
+  uint16_t top(curve >> 16);
+  uint8_t  inc((curve >> 8) & 0xFF);
+  uint8_t  dec(curve & 0xFF);
+
+  uint32_t now(millis());
+  uint32_t accel(acceleration);
+  if (accelReset.exchange(false, std::memory_order_acq_rel))
+  {
+    accel = 0;
+  }
+  else
+  {
+    uint32_t gap(now - lastDetentMs);
+    uint32_t decay(((gap > 0xFFFF) ? 0xFFFF : gap) * dec);
+    accel = (decay >= accel) ? 0 : accel - decay;
+  }
+  lastDetentMs = now;
+
+  accel       += (uint32_t)inc * steps;
+  acceleration = (accel > top) ? top : accel;
+
+  return 1 + (acceleration >> 8);
+}
+
+
+// ----------------------------------------------------------------------------
+// Turn acceleration on or off, and shape its curve (see detentSize())
+//
+void ClickEncoder::setAcceleration(bool enabled, uint16_t top, uint8_t inc, uint8_t dec)
+{
+  accelCurve.store(((uint32_t)top << 16) | ((uint32_t)inc << 8) | dec, std::memory_order_release);
+  accelReset.store(true, std::memory_order_release);
+  accelerationEnabled.store(enabled, std::memory_order_release);
 }
 
 
@@ -181,34 +337,12 @@ void ClickEncoder::unlock(void)
 void ClickEncoder::onPinChange()
 {
   lock();
-  MSB = readB();
-  LSB = readA();
+  MSB = readA();
+  LSB = readB();
 
-  int encoded = (MSB << 1) | LSB;           // Convert pin B to single number
-  int sum  = (lastEncoded << 2) | encoded;  // Add it to the previous encoded value
-
-  if(sum == 0b1101 || sum == 0b0100 || sum == 0b0010 || sum == 0b1011)
-  {
-    ++delta;
-  }
-
-  if(sum == 0b1110 || sum == 0b0111 || sum == 0b0001 || sum == 0b1000)
-  {
-    --delta;
-  }
-
-  while (delta >= steps)
-  {
-    delta -= steps;
-    ++position;
-  }
-
-  while (delta <= -steps)
-  {
-    delta += steps;
-    --position;
-  }
+  int encoded = (MSB << 1) | LSB;           // Same AB order as decode() and the ISR
 
+  addTransitions(decodeStep(lastEncoded, encoded, lastDir));
   lastEncoded = encoded;
   unlock();
 }
@@ -217,6 +351,11 @@ void ClickEncoder::onPinChange()
 
 int16_t ClickEncoder::readPosition(void)
 {
+  if (interruptMode.load(std::memory_order_acquire))
+  {
+    return isrPosition(isrState.load(std::memory_order_acquire));
+  }
+
   lock();
   int16_t ret = position;
   unlock();
@@ -32,8 +32,13 @@ ClickEncoderInterface::ClickEncoderInterface(
 { ; }
 
 
-encEvnts ClickEncoderInterface::getEvent(void)
+encEvnts ClickEncoderInterface::getEvent(int16_t *pDelta)
 {
+  if (pDelta)
+  {
+    *pDelta = 0;
+  }
+
   if (!lock())
   {
     Serial.println("shit no encoder semtake");
@@ -48,6 +53,11 @@ encEvnts ClickEncoderInterface::getEvent(void)
   int deltaPos             = pos - oldPos;
   unlock();
 
+  if (pDelta)
+  {
+    *pDelta = deltaPos;
+  }
+
   // Right Click
   if (deltaPos <= -1)
   {
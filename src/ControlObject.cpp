@@ -3,12 +3,164 @@
 #define SEM_TIMEOUT ((TickType_t)10)
 
 
+////////////////////////////////////////////////
+// Builds the boundary table. Slice k covers raw values whose map()ed control value is k;
+// the hysteresis bands reproduce the old "more than DEFAULT_THRESHOLD past the target"
+// float check exactly, just computed once here instead of on every read.
+QuantTable::QuantTable(uint16_t min, uint16_t max, uint16_t numVals):
+  rawMin(min),
+  rawMax(max),
+  numVals(numVals ? numVals : 1)
+{
+  uint32_t span((uint32_t)rawMax + 1 - rawMin);
+  sliceStart.resize(this->numVals + 1);
+  sliceBase.resize(this->numVals + 1);
+  upThresh.resize(this->numVals + 1);
+  downThresh.resize(this->numVals + 1);
+
+  for (uint32_t k(0); k <= this->numVals; ++k)
+  {
+    uint32_t base((k * span) / this->numVals + rawMin);
+    sliceBase[k]  = (uint16_t)base;
+    sliceStart[k] = (uint16_t)((k * span + this->numVals - 1) / this->numVals + rawMin);
+    upThresh[k]   = (uint16_t)floor(base * (1.0 + DEFAULT_THRESHOLD));
+    downThresh[k] = (uint16_t)ceil(base * (1.0 - DEFAULT_THRESHOLD));
+  }
+}
+
+////////////////////////////////////////////////
+// Looks for a live table in [cache] that [matches]; builds and caches one with [make] if
+// there isn't one. Shared by QuantTable and ScaleMap.
+template <typename T, typename Match, typename Make>
+static std::shared_ptr<const T> getSharedTable(std::vector<std::weak_ptr<const T>> &cache,
+                                               SemaphoreHandle_t cacheMutex,
+                                               Match matches,
+                                               Make make)
+{
+  if (pdTRUE != xSemaphoreTakeRecursive(cacheMutex, SEM_TIMEOUT))
+  {
+    // Not worth hanging over; just don't share this one
+    return make();
+  }
+
+  std::shared_ptr<const T> ret(nullptr);
+  for (auto it(cache.begin()); it != cache.end();)
+  {
+    auto pTable(it->lock());
+    if (pTable == nullptr)
+    {
+      it = cache.erase(it);
+      continue;
+    }
+
+    if (matches(*pTable))
+    {
+      ret = pTable;
+    }
+    ++it;
+  }
+
+  if (ret == nullptr)
+  {
+    ret = make();
+    cache.push_back(ret);
+  }
+
+  xSemaphoreGiveRecursive(cacheMutex);
+  return ret;
+}
+
+////////////////////////////////////////////////
+// Controls usually come in banks with identical ranges, so hand out one table per range
+std::shared_ptr<const QuantTable> QuantTable::get(uint16_t min, uint16_t max, uint16_t numVals)
+{
+  static SemaphoreHandle_t cacheMutex(xSemaphoreCreateRecursiveMutex());
+  static std::vector<std::weak_ptr<const QuantTable>> cache;
+
+  return getSharedTable<QuantTable>(
+    cache,
+    cacheMutex,
+    [=](const QuantTable &table) { return table.matches(min, max, numVals); },
+    [=]() { return std::make_shared<const QuantTable>(min, max, numVals); });
+}
+
+////////////////////////////////////////////////
+// Get the control value corresponding to a given ADC value
+uint16_t QuantTable::slice(uint16_t rawVal, uint16_t hint) const
+{
+  if (rawVal < sliceStart[1])
+  {
+    return 0;
+  }
+
+  if (rawVal >= sliceStart[numVals - 1])
+  {
+    return numVals - 1;
+  }
+
+  // Usually we're where we were last time, or one step over
+  if (hint < numVals)
+  {
+    if (rawVal >= sliceStart[hint])
+    {
+      if (rawVal < sliceStart[hint + 1])
+      {
+        return hint;
+      }
+      if ((hint + 2 <= numVals) && (rawVal < sliceStart[hint + 2]))
+      {
+        return hint + 1;
+      }
+    }
+    else if ((hint > 0) && (rawVal >= sliceStart[hint - 1]))
+    {
+      return hint - 1;
+    }
+  }
+
+  // Big jump; binary search for the last slice starting at or below rawVal
+  uint16_t lo(1);
+  uint16_t hi(numVals - 1);
+  while (lo < hi)
+  {
+    uint16_t mid((lo + hi + 1) >> 1);
+    if (sliceStart[mid] <= rawVal)
+    {
+      lo = mid;
+    }
+    else
+    {
+      hi = mid - 1;
+    }
+  }
+  return lo;
+}
+
+////////////////////////////////////////////////
+// Moves to a new slice only once the reading is part way into it
+uint16_t QuantTable::track(uint16_t rawVal, uint16_t ctrlVal) const
+{
+  uint16_t measured(slice(rawVal, ctrlVal));
+  if (measured > ctrlVal)
+  {
+    return (rawVal > upThresh[measured]) ? measured : ctrlVal;
+  }
+
+  if (measured < ctrlVal)
+  {
+    return (rawVal < downThresh[(ctrlVal > numVals) ? numVals : ctrlVal]) ? measured : ctrlVal;
+  }
+
+  return ctrlVal;
+}
+
+
 ////////////////////////////////////////////////
 // Sets LockVal to current (measured) real value regardless of LockState
 void ControlObject::overWrite()
 {
   LockState tmpState(getLockState());
-  read();
+  currentRawVal = pADC->read();
   uint16_t targetVal = rawValToControlVal(currentRawVal);
   setLockVal(targetVal);
   if (tmpState != STATE_LOCKED)
@@ -27,23 +179,135 @@ void ControlObject::unlock()
   xSemaphoreGiveRecursive(mutex);
 }
 
+////////////////////////////////////////////////
+// Lock-free; lockState only ever changes in a single store
 LockState ControlObject::getLockState(void)
+{
+  return lockState.load(std::memory_order_acquire);
+}
+
+////////////////////////////////////////////////
+// Collects every note in [lowNote, highNote] whose pitch class is in the scale
+ScaleMap::ScaleMap(uint16_t mask, uint8_t root, uint8_t lowNote, uint8_t highNote):
+  scaleMask(mask),
+  root(root),
+  lowNote(lowNote),
+  highNote(highNote)
+{
+  for (uint16_t note(lowNote); note <= highNote; ++note)
+  {
+    uint8_t interval((note + 12 - (root % 12)) % 12);
+    if (mask & (1 << interval))
+    {
+      notes.push_back((uint8_t)note);
+    }
+  }
+
+  // An empty scale would leave the control with nothing to return
+  if (notes.empty())
+  {
+    notes.push_back(lowNote);
+  }
+}
+
+std::shared_ptr<const ScaleMap> ScaleMap::get(uint16_t mask,
+                                              uint8_t root,
+                                              uint8_t lowNote,
+                                              uint8_t highNote)
+{
+  static SemaphoreHandle_t cacheMutex(xSemaphoreCreateRecursiveMutex());
+  static std::vector<std::weak_ptr<const ScaleMap>> cache;
+
+  return getSharedTable<ScaleMap>(
+    cache,
+    cacheMutex,
+    [=](const ScaleMap &map) { return map.matches(mask, root, lowNote, highNote); },
+    [=]() { return std::make_shared<const ScaleMap>(mask, root, lowNote, highNote); });
+}
+
+////////////////////////////////////////////////
+// Picks up the (shared) boundary table for the current range
+void ControlObject::rebuildTable()
+{
+  pTable = QuantTable::get(rangeMin, rangeMax, numCtrlVals);
+}
+
+void ControlObject::setMin(uint16_t min)
+{
+  if (!lock())
+  {
+    Serial.println("ctl setmin semtake failed");
+    while (1);
+  }
+  rangeMin = min;
+  rebuildTable();
+  unlock();
+}
+
+void ControlObject::setMax(uint16_t max)
+{
+  if (!lock())
+  {
+    Serial.println("ctl setmax semtake failed");
+    while (1);
+  }
+  rangeMax = max;
+  rebuildTable();
+  unlock();
+}
+
+uint16_t ControlObject::getMin(void) { return rangeMin; }
+uint16_t ControlObject::getMax(void) { return rangeMax; }
+
+////////////////////////////////////////////////
+// Switch to scale-degree values; see ControlObject.h
+void ControlObject::setScale(uint16_t scaleMask, uint8_t root, uint8_t lowNote, uint8_t highNote)
+{
+  setScaleMap(ScaleMap::get(scaleMask, root, lowNote, highNote));
+}
+
+void ControlObject::setScaleMap(std::shared_ptr<const ScaleMap> pMap)
+{
+  if (!lock())
+  {
+    Serial.println("ctl setscale semtake failed");
+    while (1);
+  }
+
+  pScale      = pMap;
+  numCtrlVals = (pScale == nullptr) ? linearNumVals : pScale->numDegrees();
+  if (lockCtrlVal >= numCtrlVals)
+  {
+    lockCtrlVal = numCtrlVals - 1;
+  }
+  rebuildTable();
+  update();
+  unlock();
+}
+
+std::shared_ptr<const ScaleMap> ControlObject::getScaleMap(void)
 {
   if (!lock())
   {
-    Serial.println("ctl getlockstate semtake failed");
+    Serial.println("ctl getscale semtake failed");
     while (1);
   }
-  LockState ret = lockState;
+  std::shared_ptr<const ScaleMap> ret(pScale);
   unlock();
   return ret;
 }
 
-void ControlObject::setMin(uint16_t min) { pADC->setMin(min); }
-void ControlObject::setMax(uint16_t max) { pADC->setMax(max); }
+////////////////////////////////////////////////
+// Note number for the current value; same as read() if there's no scale
+uint16_t ControlObject::readNote(void)
+{
+  if (serviceOnRead)
+  {
+    service();
+  }
 
-uint16_t ControlObject::getMin(void) { return pADC->getMin(); }
-uint16_t ControlObject::getMax(void) { return pADC->getMax(); }
+  return controlNote.load(std::memory_order_acquire);
+}
 
 ////////////////////////////////////////////////
 // Lock the control at its current value if it isn't already locked
@@ -59,13 +323,15 @@ void ControlObject::lockControl()
   {
     lockState = STATE_LOCKED;
   }
+  update();
 
   // Serial.printf("%p locked @ %u\n", this, lockCtrlVal);
   unlock();
 }
 
 ////////////////////////////////////////////////
-// Activates the control; it can now be unlocked
+// Activates the control; it can now be unlocked. The filter isn't reset: it may be shared
+// with the other modes on this channel, and its history is already up to date
 LockState ControlObject::reqUnlock()
 {
   LockState ret;
@@ -77,8 +343,8 @@ LockState ControlObject::reqUnlock()
   if (lockState == STATE_LOCKED)
   {
     lockState = STATE_UNLOCK_REQUESTED;
-    pADC->reset();
-    read();
+    currentRawVal = pADC->read();
+    update();
   }
   ret = lockState;
   unlock();
@@ -95,50 +361,118 @@ void ControlObject::setLockVal(int16_t jamVal)
     Serial.println("ctl setval semtake failed");
     while (1);
   }
-  uint16_t tmpVal = lockCtrlVal;
   LockState tmpState = lockState;
-  lockState = STATE_LOCKED;
   lockCtrlVal = jamVal;
   if (tmpState != STATE_LOCKED)
   {
     lockState = STATE_UNLOCK_REQUESTED;
   }
+  update();
+  unlock();
+}
+
+////////////////////////////////////////////////
+// Everything a scene needs to bring this control back, taken under one lock
+void ControlObject::exportSettings(SceneRecord &rec)
+{
+  if (!lock())
+  {
+    Serial.println("ctl export semtake failed");
+    while (1);
+  }
+  rec.lockVal   = lockCtrlVal;
+  rec.rangeMin  = rangeMin;
+  rec.rangeMax  = rangeMax;
+  rec.lockState = (uint8_t)lockState.load(std::memory_order_relaxed);
+  rec.reserved  = 0;
+  unlock();
+}
+
+////////////////////////////////////////////////
+// True if [rec] is something exportSettings() could have written for this control: a range
+// that isn't upside down, a lock value this control can take, and a real lock state
+bool ControlObject::canImport(const SceneRecord &rec)
+{
+  if (!lock())
+  {
+    Serial.println("ctl check semtake failed");
+    while (1);
+  }
+  bool ok((rec.rangeMin <= rec.rangeMax)
+       && (rec.lockVal < numCtrlVals)
+       && (rec.lockState <= STATE_LOCKED));
+  unlock();
+  return ok;
+}
+
+////////////////////////////////////////////////
+// Put back what exportSettings() saved, in one go instead of setMin() + setMax() +
+// setLockVal() each taking the lock and rebuilding the table. Changes nothing and returns
+// false if canImport() wouldn't take it.
+bool ControlObject::importSettings(const SceneRecord &rec)
+{
+  if (!lock())
+  {
+    Serial.println("ctl import semtake failed");
+    while (1);
+  }
+  if (!canImport(rec))
+  {
+    unlock();
+    return false;
+  }
+
+  rangeMin = rec.rangeMin;
+  rangeMax = rec.rangeMax;
+  rebuildTable();
+
+  lockCtrlVal = rec.lockVal;
+  lockState   = (rec.lockState == STATE_LOCKED) ? STATE_LOCKED : STATE_UNLOCK_REQUESTED;
+  update();
   unlock();
+  return true;
 }
 
 ////////////////////////////////////////////////
 // Get the control value corresponding to a given ADC value [val]
 uint16_t ControlObject::rawValToControlVal(uint16_t rawVal)
 {
-  return (uint16_t)map(rawVal, pADC->getMin(), pADC->getMax() + 1, 0, numCtrlVals);
+  return pTable->slice(rawVal, lockCtrlVal);
 }
 
 ////////////////////////////////////////////////
 // Figure out what ADC reading you'd need to match the given control value [tgtVal]
 uint16_t ControlObject::controlValToRawVal(uint16_t tgtVal)
 {
-  return (uint16_t)map(tgtVal, 0, numCtrlVals, pADC->getMin(), pADC->getMax() + 1);
+  return pTable->sliceToRaw(tgtVal);
 }
 
 ////////////////////////////////////////////////
-// Returns current ADC reading if unlocked, else returns locked value
+// Returns the control value computed by the last service() (or state change): the current
+// ADC reading if unlocked, else the locked value
 uint16_t ControlObject::read(void)
 {
-  service();
-  if (!lock())
+  if (serviceOnRead)
   {
-    Serial.println("ctl read semtake failed");
-    while (1);
+    service();
   }
 
+  return controlVal.load(std::memory_order_acquire);
+}
+
+////////////////////////////////////////////////
+// Works out the control value from the latest raw reading and publishes it for read().
+// Caller must hold the mutex.
+void ControlObject::update(void)
+{
   if (lockState == STATE_LOCKED)
   {
-    unlock();
-    return lockCtrlVal;
+    publish();
+    return;
   }
 
   // What control value would our current raw value give?
-  uint16_t currentControlVal = rawValToControlVal(currentRawVal);
+  uint16_t currentControlVal = pTable->slice(currentRawVal, lockCtrlVal);
   if (currentControlVal == lockCtrlVal)
   {
     if (lockState == STATE_UNLOCK_REQUESTED)
@@ -148,32 +482,26 @@ uint16_t ControlObject::read(void)
     }
   }
 
+  // Make sure you're part way into the neighbouring value before switching
   if (lockState == STATE_UNLOCKED)
   {
-    if (currentControlVal > lockCtrlVal)
-    {
-      uint16_t tgtRawValue = controlValToRawVal(currentControlVal);
-      // Make sure you're part way into the higher value before switching
-      if ((((float)currentRawVal - (float)tgtRawValue) / (float)tgtRawValue) > DEFAULT_THRESHOLD)
-      {
-        lockCtrlVal = currentControlVal;
-      }
-    }
-    else if (currentControlVal < lockCtrlVal)
-    {
-      uint16_t tgtRawValue = controlValToRawVal(lockCtrlVal);
-      // Make sure you're part way into the lower value before switching
-      if ((((float)tgtRawValue - (float)currentRawVal) / (float)tgtRawValue) > DEFAULT_THRESHOLD)
-      {
-        lockCtrlVal = currentControlVal;
-      }
-    }
+    lockCtrlVal = pTable->track(currentRawVal, lockCtrlVal);
   }
 
-  unlock();
-  return lockCtrlVal;
+  publish();
 }
 
+////////////////////////////////////////////////
+// Makes lockCtrlVal (and its note) visible to read(). Caller must hold the mutex.
+void ControlObject::publish(void)
+{
+  controlNote.store((pScale == nullptr) ? lockCtrlVal : pScale->degreeToNote(lockCtrlVal),
+                    std::memory_order_release);
+  controlVal.store(lockCtrlVal, std::memory_order_release);
+}
+
+////////////////////////////////////////////////
+// Samples the ADC and updates the control value. The only place the hardware gets touched.
 void ControlObject::service(void)
 {
   if (!lock())
@@ -183,6 +511,6 @@ void ControlObject::service(void)
   }
   pADC->service();
   currentRawVal = pADC->read();
+  update();
   unlock();
 }
-
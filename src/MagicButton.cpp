@@ -7,31 +7,85 @@
 #include "MagicButton.h"
 #include <DirectIO.h>
 
+////////////////////////////////////////////////
+// Gesture state machine, as a table: for each state, what to do for each combination of
+//  bit 0: button is down
+//  bit 1: the state's timeout has run out (for Released: the output has been read)
+//
+// next:   state to move to
+// report: what read() should return from now on, if hasReport is set
+struct GestureStep
+{
+  ButtonState next;
+  ButtonState report;
+  bool        hasReport;
+};
+
+#define STAY(s)         {ButtonState::s, ButtonState::Open, false}
+#define GOTO(s)         {ButtonState::s, ButtonState::Open, false}
+#define REPORT(r, s)    {ButtonState::s, ButtonState::r,    true}
+
+static const GestureStep GESTURES[8][4] =
+{
+  //                     up                              down                   up, timed out                    down, timed out
+  /* Open           */ { STAY(Open),                     GOTO(Closed),          STAY(Open),                      GOTO(Closed)                           },
+  /* Closed         */ { GOTO(Clicked),                  STAY(Closed),          GOTO(Clicked),                   GOTO(Pressed)                          },
+  /* Pressed        */ { REPORT(Pressed, Released),      STAY(Pressed),         REPORT(Pressed, Released),       REPORT(Held, Held)                     },
+  /* Clicked        */ { STAY(Clicked),                  GOTO(DoubleClicked),   REPORT(Clicked, Released),       STAY(Clicked)                          },
+  /* Held           */ { GOTO(Released),                 STAY(Held),            GOTO(Released),                  STAY(Held)                             },
+  /* DoubleClicked  */ { STAY(DoubleClicked),            STAY(DoubleClicked),   REPORT(DoubleClicked, Released), REPORT(ClickedAndHeld, ClickedAndHeld) },
+  /* ClickedAndHeld */ { GOTO(Released),                 STAY(ClickedAndHeld),  GOTO(Released),                  STAY(ClickedAndHeld)                   },
+  /* Released       */ { STAY(Released),                 STAY(Released),        REPORT(Open, Open),              REPORT(Open, Open)                     },
+};
+
+#undef STAY
+#undef GOTO
+#undef REPORT
+
+////////////////////////////////////////////////
+// States without a timeout just never time out
+void MagicButton::setTiming(const ButtonTiming &timing)
+{
+  lock();
+  for (auto &timeout : timeouts)
+  {
+    timeout = UINT32_MAX;
+  }
+  timeouts[ButtonState::Closed]        = timing.press;
+  timeouts[ButtonState::Pressed]       = timing.hold;
+  timeouts[ButtonState::Clicked]       = doubleClickable ? timing.doubleClick : 0;
+  timeouts[ButtonState::DoubleClicked] = doubleClickable ? timing.doubleClick : 0;
+  unlock();
+}
+
+void MagicButton::attachEventQueue(ButtonEventQueue *pQueue, uint8_t id)
+{
+  lock();
+  pEvents = pQueue;
+  eventId = id;
+  unlock();
+}
+
 // Read, debounce, and set output state. Once set, final output state will
 // persist until reported and reset by separate call to read()
-void MagicButton::service()
+void MagicButton::service(uint32_t now)
 {
   if (!lock())
   {
     return;
   }
 
-  long long timeStamp = 0;
-
   // Shift buffer by one and tack the current value on the end
   buff = (buff << 1) | readPin();
 
-  timeStamp = millis();
-
-  if (   (timeStamp >= (long long)debounceTS)
-      && ((timeStamp - (long long)debounceTS) >= (long long)dbnceIntvl) )
+  if ((uint32_t)(now - debounceTS) >= dbnceIntvl)
   {
     if (!buttonDown)
     {
       if ((buff & debounceUP) == debounceUP)
       {
         buttonDown = 1;
-        debounceTS = timeStamp;
+        debounceTS = now;
       }
     }
     else
@@ -39,135 +93,55 @@ void MagicButton::service()
       if ((buff | debounceDN) == debounceDN)
       {
         buttonDown = 0;
-        debounceTS = timeStamp;
+        debounceTS = now;
       }
     }
   }
 
-  long timeSinceChange = timeStamp - debounceTS;
+  updateState(now);
   unlock();
+}
 
+// Same as service(), for a button that's already been debounced elsewhere (e.g. one line
+// of a BankDebouncer): skips the pin read and the shift register and goes straight to the
+// click / hold logic
+void MagicButton::serviceDebounced(bool isDown, uint32_t now)
+{
   if (!lock())
   {
     return;
   }
 
-  switch(state[0])
+  if (isDown != buttonDown)
   {
-    // Register initial button state change
-    case ButtonState::Open:          // Not pressed, and output has been read
-    {
-      state[1] = ButtonState::Open;  // Reset output state
-      if (buttonDown)
-      {
-        state[0] = ButtonState::Closed;
-      }
-      break;
-    }
-
-    // Register single click if button went from closed to open and we
-    // didn't get a second click within DOUBLECLICKTIME
-    // Register a long press if button stays closed for PRESSTIME
-    case ButtonState::Closed:
-    {
-      if (!buttonDown)
-      {
-        if (!doubleClickable)
-        {
-          state[1] = ButtonState::Clicked;
-          state[0] = ButtonState::Released;
-          outputCleared = false;
-        }
-        else
-        {
-          state[0] = ButtonState::Clicked;
-        }
-      }
-      else if (timeSinceChange >= PRESSTIME)
-      {
-        state[0] = ButtonState::Pressed;
-      }
-      break;
-    }
-
-    case ButtonState::Clicked:
-    {
-      if (buttonDown)
-      {
-        if (timeSinceChange < DOUBLECLICKTIME)
-        {
-          state[0] = ButtonState::DoubleClicked;
-        }
-      }
-      else if (timeSinceChange >= DOUBLECLICKTIME)
-      {
-        state[1] = ButtonState::Clicked;
-        state[0] = ButtonState::Released;
-        outputCleared = false;
-      }
-      break;
-    }
-
-    case ButtonState::DoubleClicked:
-    {
-      if (timeSinceChange >= DOUBLECLICKTIME)
-      {
-        if (buttonDown)
-        {
-          state[1] = ButtonState::ClickedAndHeld;
-          state[0] = ButtonState::ClickedAndHeld;
-          outputCleared = false;
-        }
-        else if (!buttonDown)
-        {
-          state[1] = ButtonState::DoubleClicked;
-          state[0] = ButtonState::Released;
-          outputCleared = false;
-        }
-      }
-      break;
-    }
-
-    case ButtonState::Pressed:
-    {
-      if (!buttonDown)
-      {
-          state[1] = ButtonState::Pressed;
-          state[0] = ButtonState::Released;
-          outputCleared = false;
-      }
-      else if (timeSinceChange >= HOLDTIME - PRESSTIME)
-      {
-        state[1] = ButtonState::Held;
-        state[0] = ButtonState::Held;
-        outputCleared = false;
-      }
-      break;
-    }
+    buttonDown = isDown;
+    debounceTS = now;
+  }
 
-    case ButtonState::ClickedAndHeld:
-    case ButtonState::Held:
-    {
-      if (!buttonDown)
-      {
-        state[0] = ButtonState::Released;
-      }
-      break;
-    }
+  updateState(now);
+  unlock();
+}
 
-    case ButtonState::Released:
+// One step of the gesture table. Caller must hold the mutex.
+void MagicButton::updateState(uint32_t now)
+{
+  // With a queue, every gesture is handed off as soon as it's recognized, so there's never
+  // anything waiting to be read
+  ButtonState current(state[0]);
+  bool timedOut = (current == ButtonState::Released)
+                ? (outputCleared || pEvents)
+                : ((uint32_t)(now - debounceTS) >= timeouts[current]);
+
+  const GestureStep &step(GESTURES[current][(uint8_t)buttonDown | ((uint8_t)timedOut << 1)]);
+  state[0] = step.next;
+  if (step.hasReport)
+  {
+    state[1]      = step.report;
+    outputCleared = (step.report == ButtonState::Open);
+    if (pEvents && !outputCleared)
     {
-      if (outputCleared)
-      {
-        state[0] = ButtonState::Open;
-        state[1] = ButtonState::Open;
-      }
-      // State persists until external read and clear
-      break;
+      pEvents->push(ButtonEvent{now, eventId, step.report});
     }
-
-    default:
-      break;
   }
 
 #ifdef DEBUG_BUTTON_STATES
@@ -218,8 +192,7 @@ void MagicButton::service()
   tmpState[1] = state[1];
   //////////////////////////////////////////
 #endif
-  unlock();
-};
+}
 
 // Report current state and free to record further clicks.
 // State only resets if button has been released, else
@@ -31,9 +31,38 @@ void MultiModeCtrl::service()
     while (1);
   }
   getPtr()->service();
+  checkForChange();
   unlock();
 }
 
+////////////////////////////////////////////////
+// Compares the active mode against what it looked like last time. Caller must hold the mutex.
+void MultiModeCtrl::checkForChange()
+{
+  uint16_t  val(getPtr()->peek());
+  LockState state(getPtr()->getLockState());
+  if ((val != lastVal) || (state != lastLockState))
+  {
+    lastVal       = val;
+    lastLockState = state;
+    changed       = true;
+  }
+}
+
+bool MultiModeCtrl::hasChanged()
+{
+  if (!lock())
+  {
+    Serial.println("MMC changed semtake failed");
+    if (mutex == NULL) Serial.println("null ptr");
+    while (1);
+  }
+  bool ret(changed);
+  changed = false;
+  unlock();
+  return ret;
+}
+
 ////////////////////////////////////////////////
 // Sets the LockVal for the current active VirtualCtrl with its real
 // (measured) value regardless of LockState
@@ -46,6 +75,7 @@ void MultiModeCtrl::setDefaults()
     while (1);
   }
   getPtr()->overWrite();
+  checkForChange();
   unlock();
 }
 
@@ -53,7 +83,6 @@ void MultiModeCtrl::setDefaults()
 // Copies the LockVal, min_, and max_ from VirtualCtrl[source] into VirtualCtrl[dest]
 void MultiModeCtrl::copySettings(uint8_t dest, int8_t source)
 {
-  printf("copying slot %u [val=%i] to slot %u\n", source, pVirtualCtrls.at(source)->read(), dest);
   if ((int8_t)dest == source)
   {
     return;
@@ -86,6 +115,7 @@ void MultiModeCtrl::copySettings(std::shared_ptr<ControlObject> pDest,
   LockState tmpState(pDest->getLockState());
   // TODO: compare number of control vals
   pDest->lockControl();
+  pDest->setScaleMap(pSource->getScaleMap());
   pDest->setLockVal(pSource->read());
   pDest->setMin(pSource->getMin());
   pDest->setMax(pSource->getMax());
@@ -4,9 +4,49 @@
 MuxedEncoder::MuxedEncoder(const uint8_t * const pinNums,
                            uint8_t stepsPerNotch):
   ClickEncoder(-1, -1, -1, stepsPerNotch, true),
-  _BITMASK{uint16_t((uint16_t)1 << pinNums[0]), uint16_t((uint16_t)1 << pinNums[1])}
+  _BITMASK{uint16_t((uint16_t)1 << pinNums[0]), uint16_t((uint16_t)1 << pinNums[1])},
+  _BTNMASK((uint16_t)1 << pinNums[2]),
+  _SLOT(-1)
 {
   hwButton = std::make_shared<MuxedButton>(pinNums[2]);
+
+  // Every MuxedEncoder shares one mutex, so serviceAll() can take it once for all of them
+  vSemaphoreDelete(encoderMutex);
+  encoderMutex = _BANK_MUTEX;
+
+  lock();
+  for (uint8_t n(0); n < MAX_ENCODERS; ++n)
+  {
+    if (!_DECODER.isAttached(n))
+    {
+      _SLOT = n;
+      _DECODER.attach(n, pinNums[1], pinNums[0], _REGISTER);
+      break;
+    }
+  }
+  assert(_SLOT >= 0);
+  _INSTANCES.push_back(this);
+  unlock();
+}
+
+
+MuxedEncoder::~MuxedEncoder()
+{
+  lock();
+  if (_SLOT >= 0)
+  {
+    _DECODER.detach(_SLOT);
+  }
+
+  for (auto it(_INSTANCES.begin()); it != _INSTANCES.end(); ++it)
+  {
+    if (*it == this)
+    {
+      _INSTANCES.erase(it);
+      break;
+    }
+  }
+  unlock();
 }
 
 
@@ -24,8 +64,15 @@ bool MuxedEncoder::readA()
 
 void MuxedEncoder::init()
 {
+  lock();
   MSB = (long)readA();
   LSB = (long)readB();
+  lastEncoded = (MSB << 1) | LSB;
+  if (_SLOT >= 0)
+  {
+    _DECODER.attach(_SLOT, __builtin_ctz(_BITMASK[1]), __builtin_ctz(_BITMASK[0]), _REGISTER);
+  }
+  unlock();
   hwButton->service();
 }
 
@@ -43,6 +90,43 @@ void MuxedEncoder::service()
 }
 
 
+void MuxedEncoder::serviceAll(uint32_t now)
+{
+  uint16_t reg(_SHARED_MUX->getReg());
+
+  if (xSemaphoreTakeRecursive(_BANK_MUTEX, MUTEX_TIMEOUT) == pdTRUE)
+  {
+    _REGISTER = reg;
+
+    int8_t   transitions[MAX_ENCODERS];
+    uint16_t moved(_DECODER.decode(reg, transitions));
+    for (auto pEncoder : _INSTANCES)
+    {
+      int8_t slot(pEncoder->_SLOT);
+      if ((slot < 0) || !(moved & ((uint16_t)1 << slot)))
+      {
+        continue;
+      }
+
+      // The decoder keeps its own skipped-state counts; fold them into the encoder's
+      QuadErrors errors(_DECODER.readErrors(slot, true));
+      pEncoder->skippedCount.fetch_add(errors.skipped, std::memory_order_relaxed);
+      pEncoder->unrecoveredCount.fetch_add(errors.unrecovered, std::memory_order_relaxed);
+
+      pEncoder->addTransitions(transitions[slot]);
+    }
+    xSemaphoreGiveRecursive(_BANK_MUTEX);
+  }
+
+  _BUTTON_LINES.service(reg);
+  uint32_t down(_BUTTON_LINES.getState());
+  for (auto pEncoder : _INSTANCES)
+  {
+    pEncoder->hwButton->serviceDebounced(down & pEncoder->_BTNMASK, now);
+  }
+}
+
+
 void MuxedEncoder::setMux(HW_Mux *pMux)
 {
   _SHARED_MUX = std::shared_ptr<HW_Mux>(pMux);
@@ -20,24 +20,27 @@ HardwareCtrl::HardwareCtrl(
     adcMax     (pADC->maxValue()),
     buffSize   (constrain(numSamps, 1, MAX_BUFFER_SIZE-1)),
     sampleIdx  (0),
-    sum_       (0),
+    runningSum (0),
+    mean_      (0),
     bufferReady(false)
 {
-  cli();
-  for (uint8_t ii = 0; ii < MAX_BUFFER_SIZE; ++ii)
+  // Fill the window so we already have a good average to start with
+  int32_t sum(0);
+  for (uint8_t ii = 0; ii < buffSize; ++ii)
   {
-    // Fill buffer so we already have a good average to start with
     buff[ii] = pADC->analogRead(ch);
-    sum_ += buff[ii];
+    sum += buff[ii];
   }
-  // bufferReady = true;
-  sampleIdx = buffSize;
-  sei();
+
+  runningSum = sum;
+  mean_.store(int16_t(sum / buffSize), std::memory_order_release);
+  bufferReady.store(true, std::memory_order_release);
 }
 
 
 ////////////////////////////////////////////////
-// Call this in an ISR at like 1ms or something
+// Call this in an ISR at like 1ms or something. Swaps the oldest sample out of the running
+// sum and works out the new mean, so read() never has to touch the buffer.
 void HardwareCtrl::service()
 {
   if (pADC == NULL)
@@ -45,16 +48,21 @@ void HardwareCtrl::service()
     return;
   }
 
-  cli();
-  // Add one sample to the buffer
-  buff[sampleIdx] = pADC->analogRead(ch);
+  // The SPI transfer happens outside the critical section
+  int16_t sample(pADC->analogRead(ch));
+
+  portENTER_CRITICAL(&windowLock);
+  runningSum += sample - buff[sampleIdx];
+  buff[sampleIdx] = sample;
   ++sampleIdx;
   if (sampleIdx >= buffSize)
   {
-    sampleIdx   = 0;
-    bufferReady = true;
+    sampleIdx = 0;
   }
-  sei();
+  int16_t mean(int16_t(runningSum / buffSize));
+  portEXIT_CRITICAL(&windowLock);
+
+  mean_.store(mean, std::memory_order_release);
 }
 
 
@@ -62,48 +70,16 @@ void HardwareCtrl::service()
 // Report 'ready' if buffer is full
 bool HardwareCtrl::isReady()
 {
-  cli();
-  bool retVal = bufferReady;
-  sei();
-  return retVal;
+  return bufferReady.load(std::memory_order_acquire);
 }
 
 
 ////////////////////////////////////////////////
-// Get the (smoothed) raw ADC value
+// Get the (smoothed) raw ADC value: the mean of the last buffSize samples. Lock-free; safe
+// from either core.
 int16_t HardwareCtrl::read()
 {
-  uint8_t samps;
-  int16_t retVal;
-  sum_ = 0;
-
-  cli();
-  // Buffer isn't full; just return the first sample
-  if (!bufferReady)
-  {
-    samps  = 0;
-    retVal = buff[0];
-  }
-  else
-  {
-    samps = buffSize;
-  }
-  sei();
-
-  if (samps == 0)
-  {
-    return retVal;
-  }
-
-  // Take the mean of all samples in the buffer
-  cli();
-  for (uint8_t ii = 0; ii < buffSize; ++ii)
-  {
-    sum_ += buff[ii];
-  }
-  sei();
-
-  return int16_t(sum_ / (int16_t)buffSize);
+  return mean_.load(std::memory_order_acquire);
 }
 
 
@@ -126,17 +102,24 @@ LockingCtrl::LockingCtrl(
   uint8_t adcChannel,
   int16_t inVal,
   bool    createLocked):
+    LockingCtrl(std::make_shared<HardwareCtrl>(inAdc, adcChannel, MAX_BUFFER_SIZE),
+                inVal,
+                createLocked)
+{ ; }
+
+
+////////////////////////////////////////////////
+// Constructor sharing an existing HardwareCtrl. Its window is filled when it's built, so
+// there's nothing to wait for here.
+LockingCtrl::LockingCtrl(
+  std::shared_ptr<HardwareCtrl> pHwCtrl,
+  int16_t inVal,
+  bool    createLocked):
+    pHwCtrl_(pHwCtrl),
     min_    (0),
-    max_    (inAdc->maxValue()),
+    max_    (pHwCtrl->maxValue()),
     lockVal_ (inVal)
 {
-  pHwCtrl_ = std::make_shared<HardwareCtrl>(inAdc, adcChannel, MAX_BUFFER_SIZE);
-  // dbprintf("LockingCtrl %p::pHwCtrl = %p\n", this, pHwCtrl_);
-  while (!pHwCtrl_->isReady())
-  {
-    pHwCtrl_->service();
-  }
-  // dbprintf("  HwCtrl %p initialized!\n\n", pHwCtrl_);
   threshInt_ = static_cast<uint16_t>( (uint16_t)(DEFAULT_THRESHOLD * max_ + 0.5) );
   state_ = STATE_LOCKED;
   if (!createLocked)
@@ -174,27 +157,25 @@ int16_t LockingCtrl::getLockVal()
 // LockState getter
 LockState LockingCtrl::getLockState()
 {
-  LockState tmpState;
-  cli();
-  tmpState = state_;
-  sei();
-  return tmpState;
+  return state_.load(std::memory_order_acquire);
 }
 
 
 ////////////////////////////////////////////////
-// LockState setter
+// LockState setter; returns the previous state
 LockState LockingCtrl::setLockState_(LockState state)
 {
-  LockState tmpState(getLockState());
-  if (state != tmpState)
-  {
-    cli();
-    state_ = state;
-    sei();
-  }
+  return state_.exchange(state, std::memory_order_acq_rel);
+}
+
 
-  return tmpState;
+////////////////////////////////////////////////
+// UNLOCK_REQUESTED -> UNLOCKED, unless someone (e.g. on the other core) locked the control
+// since we looked
+bool LockingCtrl::tryUnlock_()
+{
+  LockState expected(STATE_UNLOCK_REQUESTED);
+  return state_.compare_exchange_strong(expected, STATE_UNLOCKED, std::memory_order_acq_rel);
 }
 
 
@@ -217,9 +198,8 @@ int16_t LockingCtrl::read()
   }
 
   // STATE_UNLOCK_REQUESTED
-  if (abs(lockVal_ - tmpVal) < threshInt_)
+  if ((abs(lockVal_ - tmpVal) < threshInt_) && tryUnlock_())
   {
-    setLockState_(STATE_UNLOCKED);
     return tmpVal;
   }
 
@@ -269,11 +249,8 @@ void LockingCtrl::lockControl()
 // Activates the control; it can now be unlocked
 LockState LockingCtrl::reqUnlock()
 {
-  if (getLockState() == STATE_LOCKED)
-  {
-    // dbprintf("LockingCtrl    %p UNLOCK_REQUESTED\n", this);
-    setLockState_(STATE_UNLOCK_REQUESTED);
-  }
+  LockState expected(STATE_LOCKED);
+  state_.compare_exchange_strong(expected, STATE_UNLOCK_REQUESTED, std::memory_order_acq_rel);
 
   read();
   return getLockState();
@@ -305,12 +282,24 @@ VirtualCtrl::VirtualCtrl(
   int16_t max,
   int16_t min,
   bool createLocked):
-    LockingCtrl(inAdc, adcChannel, inSlice, createLocked)
+    VirtualCtrl(std::make_shared<HardwareCtrl>(inAdc, adcChannel, MAX_BUFFER_SIZE),
+                inSlice,
+                max,
+                min,
+                createLocked)
+{ ; }
+
+
+////////////////////////////////////////////////
+// Constructor sharing an existing HardwareCtrl
+VirtualCtrl::VirtualCtrl(
+  std::shared_ptr<HardwareCtrl> pHwCtrl,
+  int16_t inSlice,
+  int16_t max,
+  int16_t min,
+  bool createLocked):
+    LockingCtrl(pHwCtrl, inSlice, createLocked)
 {
-  while (!pHwCtrl_->isReady())
-  {
-    pHwCtrl_->service();
-  }
   threshInt_ = static_cast<uint16_t>( (uint16_t)(DEFAULT_THRESHOLD * max_ + 0.5) );
   state_     = STATE_LOCKED;
   min_       = min;
@@ -369,9 +358,8 @@ int16_t VirtualCtrl::read()
   // STATE_UNLOCK_REQUESTED
   int16_t targetVal  = sliceToVal(lockVal_);
   // if (abs(targetVal - rawHwVal) < threshInt_)
-  if (rawHwSlice == lockVal_)
+  if ((rawHwSlice == lockVal_) && tryUnlock_())
   {
-    setLockState_(STATE_UNLOCKED);
     // dbprintf("VirtualControl %p UNLOCKED @ %d [%d, tgtVal=%d]\n", this, rawHwSlice, rawHwVal, targetVal);
     return rawHwSlice;
   }
@@ -414,18 +402,19 @@ MultiModeCtrl::MultiModeCtrl(
   uint8_t numVals):
     numModes_(numCtrls)
 {
+  // One sampler for the physical channel, shared by every mode: its window is filled once
+  // here instead of once per VirtualCtrl, and one service() a tick keeps them all current
+  auto pHwCtrl(std::make_shared<HardwareCtrl>(inAdc, adcChannel, MAX_BUFFER_SIZE));
   for (auto idx(0); idx < numModes_; ++idx)
   {
-    pVirtualCtrls.push_back(std::make_shared<VirtualCtrl>(inAdc,
-                                                          adcChannel,
+    pVirtualCtrls.push_back(std::make_shared<VirtualCtrl>(pHwCtrl,
                                                           numVals / 2,
                                                           numVals));
   }
   // This is not merely a pointer to an existing control because we want to edit and modify it
   // without affecting the control it was originally based on. That's why we need to copy the pDest
   // fields into it rather than pointing it somewhere else
-  pActiveCtrl = std::make_shared<VirtualCtrl>(inAdc,
-                                              adcChannel,
+  pActiveCtrl = std::make_shared<VirtualCtrl>(pHwCtrl,
                                               numVals / 2,
                                               numVals,
                                               0,
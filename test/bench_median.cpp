@@ -0,0 +1,79 @@
+////////////////////////////////////////////////////////////////////////////////////////////
+//
+// MedianFilter: per-sample cost for window sizes 3, 5, 9 and 15, after checking each one
+// against a sort-the-window reference on spiky input. Host numbers; they show how cost
+// grows with the window, not what an ESP32 will do.
+//
+#include <ADC_Filters.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+typedef std::chrono::steady_clock Clock;
+
+static const int CHECK_SAMPLES(20000);
+static const int BENCH_SAMPLES(5000000);
+
+template <uint8_t N>
+static bool matchesReference(void)
+{
+  MedianFilter<N> median;
+  median.reset();
+
+  // Mostly a quiet fader, with a full-scale spike every third sample
+  std::mt19937 rng(N);
+  std::uniform_int_distribution<int> spike(0, 4095);
+  std::vector<uint16_t> history;
+  for (int n = 0; n < CHECK_SAMPLES; ++n)
+  {
+    uint16_t sample((n % 3) ? (uint16_t)(2000 + rng() % 7) : (uint16_t)spike(rng));
+    median.push(sample);
+    history.push_back(sample);
+
+    size_t width(std::min<size_t>(N, history.size()));
+    std::vector<uint16_t> window(history.end() - width, history.end());
+    std::sort(window.begin(), window.end());
+    if (window[width / 2] != median.value())
+    {
+      printf("  N=%2u: mismatch at sample %d\n", N, n);
+      return false;
+    }
+  }
+
+  return true;
+}
+
+template <uint8_t N>
+static bool run(void)
+{
+  if (!matchesReference<N>())
+  {
+    return false;
+  }
+
+  MedianFilter<N> median;
+  median.reset();
+
+  volatile uint32_t sink(0);
+  uint32_t x(1);
+  auto t0(Clock::now());
+  for (int n = 0; n < BENCH_SAMPLES; ++n)
+  {
+    x = x * 1664525 + 1013904223;   // Cheap LCG so the input isn't trivially sorted
+    median.push(x >> 20);
+    sink = sink + median.value();
+  }
+  double ns(std::chrono::duration<double, std::nano>(Clock::now() - t0).count() / BENCH_SAMPLES);
+
+  printf("  N=%2u: %5.1f ns/sample\n", N, ns);
+  return true;
+}
+
+int main()
+{
+  printf("bench_median (host)\n");
+  bool ok(run<3>() && run<5>() && run<9>() && run<15>());
+  return ok ? 0 : 1;
+}
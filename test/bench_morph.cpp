@@ -0,0 +1,86 @@
+////////////////////////////////////////////////////////////////////////////////////////////
+//
+// ControllerBank scene morphing, 16 controls x 8 scenes: per-tick cost of publishing a
+// morph step, of a whole service() tick with and without a morph running, and of the
+// do-it-by-hand alternative (setLockVal() on every control each tick). Host numbers, and
+// the stub mutexes cost nothing, so the by-hand figure flatters it.
+//
+#include <ControllerBank.h>
+#include <chrono>
+#include <cstdio>
+
+typedef std::chrono::steady_clock Clock;
+
+static const uint8_t CONTROLS(16);
+static const uint8_t SCENES(8);
+static const int     TICKS(200000);
+
+template <typename Fn>
+static double nsPerTick(Fn fn)
+{
+  auto t0(Clock::now());
+  for (int tick = 0; tick < TICKS; ++tick)
+  {
+    fn(tick);
+  }
+  return std::chrono::duration<double, std::nano>(Clock::now() - t0).count() / TICKS;
+}
+
+int main()
+{
+  uint8_t pins[CONTROLS] = {};
+  ControllerBank bank(pins, CONTROLS, SCENES, 127);
+  for (uint8_t scene(0); scene < SCENES; ++scene)
+  {
+    bank.selectScene(scene, false);
+    for (uint8_t n(0); n < CONTROLS; ++n)
+    {
+      bank.getPtr(n)->setLockVal((scene * 13 + n * 7) % 128);
+    }
+  }
+  bank.selectScene(0, false);
+
+  volatile uint16_t sink(0);
+
+  bank.startMorph(1, 7);
+  double publish(nsPerTick([&](int tick)
+  {
+    bank.setMorphPosition((uint32_t)tick & (MORPH_FULL - 1));
+    sink = sink + bank.read(CONTROLS - 1);
+  }));
+  bank.stopMorph();
+
+  double idle(nsPerTick([&](int)
+  {
+    bank.service();
+    sink = sink + bank.read(CONTROLS - 1);
+  }));
+
+  bank.startMorph(1, 7, 0xFFFF);
+  double morphing(nsPerTick([&](int)
+  {
+    bank.service();
+    sink = sink + bank.read(CONTROLS - 1);
+  }));
+  bank.stopMorph();
+
+  // By hand: work out every control's blend and push it through setLockVal()
+  double byHand(nsPerTick([&](int tick)
+  {
+    uint32_t pos((uint32_t)tick & (MORPH_FULL - 1));
+    for (uint8_t n(0); n < CONTROLS; ++n)
+    {
+      int32_t a((1 * 13 + n * 7) % 128);
+      int32_t b((7 * 13 + n * 7) % 128);
+      bank.getPtr(n)->setLockVal(a + (((b - a) * (int32_t)pos) >> 16));
+    }
+    sink = sink + bank.read(CONTROLS - 1);
+  }));
+
+  printf("bench_morph (host, %u controls x %u scenes)\n", CONTROLS, SCENES);
+  printf("  morph step published:    %7.1f ns/tick\n", publish);
+  printf("  service(), no morph:     %7.1f ns/tick\n", idle);
+  printf("  service(), morphing:     %7.1f ns/tick\n", morphing);
+  printf("  setLockVal() x %u:       %7.1f ns/tick\n", CONTROLS, byHand);
+  return 0;
+}
@@ -0,0 +1,121 @@
+////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Sample publication: SeqLock and a plain atomic (what ADC_Object uses now) against a
+// recursive mutex around the same data (what it used to do). Measures uncontended read
+// cost, then read throughput and worst-case read latency with a writer hammering away on
+// another thread. Host numbers; they show the shape, not what an ESP32 will do.
+//
+#include <SeqLock.h>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <mutex>
+#include <thread>
+
+typedef std::chrono::steady_clock Clock;
+
+static const int UNCONTENDED_READS(10000000);
+static const int CONTENDED_MS(500);
+
+// What SmoothedADC used to guard: a running sum and a sample count
+struct Sample
+{
+  uint32_t sum;
+  uint32_t count;
+};
+
+struct MutexPath
+{
+  std::recursive_mutex mutex;
+  Sample               value{};
+
+  void   write(const Sample &s) { std::lock_guard<std::recursive_mutex> guard(mutex); value = s; }
+  Sample read()                 { std::lock_guard<std::recursive_mutex> guard(mutex); return value; }
+};
+
+struct SeqLockPath
+{
+  SeqLock<Sample> value;
+
+  void   write(const Sample &s) { value.write(s); }
+  Sample read()                 { return value.read(); }
+};
+
+// A single uint16_t sample, the way MCP_Channel and ESP32_ADC_Channel publish now
+struct AtomicPath
+{
+  std::atomic<uint16_t> value{0};
+
+  void   write(const Sample &s) { value.store((uint16_t)s.sum, std::memory_order_release); }
+  Sample read()                 { return Sample{value.load(std::memory_order_acquire), 1}; }
+};
+
+template <typename Path>
+static void run(const char *name)
+{
+  Path path;
+
+  // Uncontended
+  volatile uint32_t sink(0);
+  auto t0(Clock::now());
+  for (int n = 0; n < UNCONTENDED_READS; ++n)
+  {
+    sink = sink + path.read().sum;
+  }
+  double uncontendedNs(std::chrono::duration<double, std::nano>(Clock::now() - t0).count()
+                       / UNCONTENDED_READS);
+
+  // One writer, two readers
+  std::atomic<bool> done(false);
+  std::thread writer([&]()
+  {
+    uint32_t n(0);
+    while (!done.load(std::memory_order_relaxed))
+    {
+      ++n;
+      path.write(Sample{n * 7, n});
+    }
+  });
+
+  std::atomic<uint64_t> totalReads(0);
+  std::atomic<int64_t>  worstNs(0);
+  auto reader = [&]()
+  {
+    uint64_t reads(0);
+    int64_t  worst(0);
+    while (!done.load(std::memory_order_relaxed))
+    {
+      auto start(Clock::now());
+      sink = sink + path.read().count;
+      int64_t ns(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count());
+      worst = (ns > worst) ? ns : worst;
+      ++reads;
+    }
+    totalReads += reads;
+    int64_t prev(worstNs.load());
+    while ((worst > prev) && !worstNs.compare_exchange_weak(prev, worst)) { ; }
+  };
+
+  std::thread readerA(reader);
+  std::thread readerB(reader);
+  std::this_thread::sleep_for(std::chrono::milliseconds(CONTENDED_MS));
+  done.store(true);
+  writer.join();
+  readerA.join();
+  readerB.join();
+
+  printf("  %-10s %6.1f ns/read uncontended   %7.2f M reads/s contended   worst read %6.1f us\n",
+         name,
+         uncontendedNs,
+         totalReads.load() / (CONTENDED_MS * 1000.0),
+         worstNs.load() / 1000.0);
+}
+
+int main()
+{
+  printf("bench_seqlock (host, %u hardware threads)\n", std::thread::hardware_concurrency());
+  run<MutexPath>("mutex");
+  run<SeqLockPath>("SeqLock");
+  run<AtomicPath>("atomic");
+  return 0;
+}
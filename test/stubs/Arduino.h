@@ -0,0 +1,80 @@
+////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Host test stub: just enough of the Arduino-ESP32 core for the library to build on a PC
+//
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <cmath>
+#include <cassert>
+#include <array>
+#include <algorithm>
+#include <freertos/semphr.h>
+
+typedef uint8_t byte;
+
+struct SerialStub
+{
+  template <typename... Args> void print(Args...)   { ; }
+  template <typename... Args> void println(Args...) { ; }
+  template <typename... Args> void printf(Args...)  { ; }
+  explicit operator bool() { return true; }
+};
+extern SerialStub Serial;
+
+// Time only moves when a test says so
+unsigned long millis();
+unsigned long micros();
+void setFakeMillis(unsigned long ms);
+
+void pinMode(int pin, int mode);
+void digitalWrite(int pin, int val);
+int  digitalRead(int pin);
+void delay(unsigned ms);
+void delayMicroseconds(unsigned us);
+long map(long x, long inMin, long inMax, long outMin, long outMax);
+void cli();
+void sei();
+
+#define INPUT           1
+#define INPUT_PULLUP    2
+#define INPUT_PULLDOWN  3
+#define OUTPUT          4
+#define HIGH            1
+#define LOW             0
+#define CHANGE          3
+#define LSBFIRST        0
+#define IRAM_ATTR
+#define DRAM_ATTR
+
+int  digitalPinToInterrupt(int pin);
+void attachInterruptArg(uint8_t irq, void (*isr)(void *), void *pArg, int mode);
+void detachInterrupt(uint8_t irq);
+
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+#define bitRead(value, bit)       (((value) >> (bit)) & 0x01)
+#define bitSet(value, bit)        ((value) = (value) | (1UL << (bit)))
+#define bitClear(value, bit)      ((value) = (value) & ~(1UL << (bit)))
+#define bitWrite(value, bit, bitvalue) ((bitvalue) ? bitSet(value, bit) : bitClear(value, bit))
+#define BIT0 (1 << 0)
+#define BIT1 (1 << 1)
+#define BIT2 (1 << 2)
+#define BIT3 (1 << 3)
+#define BIT4 (1 << 4)
+#define BIT5 (1 << 5)
+#define BIT6 (1 << 6)
+#define BIT7 (1 << 7)
+#define BIT8 (1 << 8)
+
+// GPIO registers, for DirectIO; tests set GPIO.in to fake pin levels
+struct GPIOregs
+{
+  uint32_t out_w1tc;
+  uint32_t out_w1ts;
+  uint32_t in;
+  struct { uint32_t val; } out1_w1tc, out1_w1ts, in1;
+};
+extern GPIOregs GPIO;
@@ -0,0 +1,15 @@
+// Host test stub for madhephaestus/ESP32AnalogRead. Every pin reads whatever esp32ReadHook
+// returns (0 if it's not set).
+#pragma once
+#include <cstdint>
+
+extern uint16_t (*esp32ReadHook)(int pin);
+
+class ESP32AnalogRead
+{
+public:
+  int      pin = -1;
+
+  void     attach(int pin);
+  uint16_t readRaw();
+};
@@ -0,0 +1,41 @@
+////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Host test stub for the ESP32 fs::FS interface: an in-memory file system
+//
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+#define FILE_READ  "r"
+#define FILE_WRITE "w"
+
+namespace fs
+{
+  class File
+  {
+    std::vector<uint8_t> *pData;
+    size_t                pos;
+
+  public:
+    File(std::vector<uint8_t> *pFileData = nullptr): pData(pFileData), pos(0) { ; }
+
+    size_t write(const uint8_t *buf, size_t len);
+    size_t read(uint8_t *buf, size_t len);
+    size_t size();
+    void   close() { pData = nullptr; }
+    explicit operator bool() const { return pData != nullptr; }
+  };
+
+  class FS
+  {
+    std::map<std::string, std::vector<uint8_t>> files;
+
+  public:
+    File open(const char *path, const char *mode);
+    bool exists(const char *path) { return files.count(path) != 0; }
+  };
+}
@@ -0,0 +1,2 @@
+// Host test stub: only needs to exist for the includes to resolve
+#pragma once
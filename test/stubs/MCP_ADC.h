@@ -0,0 +1,28 @@
+////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Host test stub for robtillaart/MCP_ADC. Every channel reads whatever mcpReadHook returns
+// (0 if it's not set).
+//
+#pragma once
+
+#include <cstdint>
+
+extern int16_t (*mcpReadHook)(uint8_t channel);
+
+class MCP_ADC
+{
+public:
+  MCP_ADC(uint8_t dataIn = 255, uint8_t dataOut = 255, uint8_t clock = 255) { ; }
+  virtual ~MCP_ADC() { ; }
+
+  uint8_t channels();
+  int16_t maxValue();
+  int16_t analogRead(uint8_t channel);
+  void    begin(uint8_t select);
+  void    setGPIOpins(uint8_t clk, uint8_t miso, uint8_t mosi, uint8_t select);
+};
+
+#define MCP_STUB(name) class name : public MCP_ADC { public: using MCP_ADC::MCP_ADC; };
+MCP_STUB(MCP3001) MCP_STUB(MCP3002) MCP_STUB(MCP3004) MCP_STUB(MCP3008)
+MCP_STUB(MCP3201) MCP_STUB(MCP3202) MCP_STUB(MCP3204) MCP_STUB(MCP3208)
+#undef MCP_STUB
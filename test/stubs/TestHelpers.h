@@ -0,0 +1,34 @@
+////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Bare-bones checks for the host tests: CHECK() reports and counts failures, and each test
+// returns TEST_RESULT() from main()
+//
+#pragma once
+
+#include <cstdio>
+
+static int testFailures(0);
+
+#define CHECK(cond)                                                              \
+  do                                                                             \
+  {                                                                              \
+    if (!(cond))                                                                 \
+    {                                                                            \
+      printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond);                     \
+      ++testFailures;                                                            \
+    }                                                                            \
+  } while (0)
+
+#define CHECK_EQ(a, b)                                                           \
+  do                                                                             \
+  {                                                                              \
+    long long va_((long long)(a)), vb_((long long)(b));                          \
+    if (va_ != vb_)                                                              \
+    {                                                                            \
+      printf("FAIL %s:%d: %s == %s (%lld vs %lld)\n", __FILE__, __LINE__, #a, #b, va_, vb_); \
+      ++testFailures;                                                            \
+    }                                                                            \
+  } while (0)
+
+#define TEST_RESULT()                                                            \
+  (printf("%s: %s\n", __FILE__, testFailures ? "FAILED" : "ok"), testFailures ? 1 : 0)
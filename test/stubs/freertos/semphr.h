@@ -0,0 +1,37 @@
+////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Host test stub: FreeRTOS semaphores and ESP32 spinlocks, backed by std:: primitives
+//
+#pragma once
+
+#include <cstdint>
+#include <atomic>
+
+typedef void    *SemaphoreHandle_t;
+typedef void    *QueueHandle_t;
+typedef uint32_t TickType_t;
+typedef struct { void *dummy[20]; } StaticSemaphore_t;
+
+#define pdTRUE  1
+#define pdFALSE 0
+
+SemaphoreHandle_t xSemaphoreCreateRecursiveMutex();
+SemaphoreHandle_t xSemaphoreCreateRecursiveMutexStatic(StaticSemaphore_t *pBuffer);
+int xSemaphoreTakeRecursive(SemaphoreHandle_t sem, TickType_t timeout);
+int xSemaphoreGiveRecursive(SemaphoreHandle_t sem);
+int xSemaphoreTake(SemaphoreHandle_t sem, TickType_t timeout);
+int xSemaphoreGive(SemaphoreHandle_t sem);
+void vSemaphoreDelete(SemaphoreHandle_t sem);
+
+// A real spinlock, so cross-thread stress tests mean something
+typedef struct { std::atomic<uint32_t> owner; uint32_t count; } portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED {0, 0}
+
+void portENTER_CRITICAL(portMUX_TYPE *pMux);
+void portEXIT_CRITICAL(portMUX_TYPE *pMux);
+void portENTER_CRITICAL_ISR(portMUX_TYPE *pMux);
+void portEXIT_CRITICAL_ISR(portMUX_TYPE *pMux);
+void spinlock_initialize(portMUX_TYPE *pMux);
+
+void taskYIELD();
+void vTaskDelay(TickType_t ticks);
@@ -0,0 +1,3 @@
+// Host test stub
+#pragma once
+#include <freertos/semphr.h>
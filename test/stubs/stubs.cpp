@@ -0,0 +1,114 @@
+////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Host test stub implementations
+//
+#include <Arduino.h>
+#include <MCP_ADC.h>
+#include <ESP32AnalogRead.h>
+#include <FS.h>
+#include <thread>
+
+SerialStub Serial;
+GPIOregs   GPIO;
+
+static std::atomic<unsigned long> fakeMillis(0);
+
+unsigned long millis()                { return fakeMillis.load(); }
+unsigned long micros()                { return fakeMillis.load() * 1000; }
+void setFakeMillis(unsigned long ms)  { fakeMillis.store(ms); }
+
+void pinMode(int, int)                { ; }
+void digitalWrite(int, int)           { ; }
+int  digitalRead(int)                 { return 0; }
+void delay(unsigned)                  { ; }
+void delayMicroseconds(unsigned)      { ; }
+void cli()                            { ; }
+void sei()                            { ; }
+
+long map(long x, long inMin, long inMax, long outMin, long outMax)
+{
+  return (x - inMin) * (outMax - outMin) / (inMax - inMin) + outMin;
+}
+
+int  digitalPinToInterrupt(int pin)                         { return pin; }
+void attachInterruptArg(uint8_t, void (*)(void *), void *, int) { ; }
+void detachInterrupt(uint8_t)                               { ; }
+
+// Mutexes are no-ops: tests that exercise threads only touch lock-free or spinlock paths
+SemaphoreHandle_t xSemaphoreCreateRecursiveMutex()                          { return (void *)1; }
+SemaphoreHandle_t xSemaphoreCreateRecursiveMutexStatic(StaticSemaphore_t *) { return (void *)1; }
+int xSemaphoreTakeRecursive(SemaphoreHandle_t, TickType_t)  { return pdTRUE; }
+int xSemaphoreGiveRecursive(SemaphoreHandle_t)              { return pdTRUE; }
+int xSemaphoreTake(SemaphoreHandle_t, TickType_t)           { return pdTRUE; }
+int xSemaphoreGive(SemaphoreHandle_t)                       { return pdTRUE; }
+void vSemaphoreDelete(SemaphoreHandle_t)                    { ; }
+
+void portENTER_CRITICAL(portMUX_TYPE *pMux)
+{
+  uint32_t unlocked(0);
+  while (!pMux->owner.compare_exchange_weak(unlocked, 1, std::memory_order_acquire))
+  {
+    unlocked = 0;
+    std::this_thread::yield();
+  }
+}
+
+void portEXIT_CRITICAL(portMUX_TYPE *pMux)      { pMux->owner.store(0, std::memory_order_release); }
+void portENTER_CRITICAL_ISR(portMUX_TYPE *pMux) { portENTER_CRITICAL(pMux); }
+void portEXIT_CRITICAL_ISR(portMUX_TYPE *pMux)  { portEXIT_CRITICAL(pMux); }
+void spinlock_initialize(portMUX_TYPE *pMux)    { pMux->owner.store(0); pMux->count = 0; }
+
+void taskYIELD()           { std::this_thread::yield(); }
+void vTaskDelay(TickType_t) { std::this_thread::yield(); }
+
+int16_t (*mcpReadHook)(uint8_t channel) = nullptr;
+
+uint8_t MCP_ADC::channels()                 { return 8; }
+int16_t MCP_ADC::maxValue()                 { return 4095; }
+int16_t MCP_ADC::analogRead(uint8_t ch)     { return mcpReadHook ? mcpReadHook(ch) : 0; }
+void    MCP_ADC::begin(uint8_t)             { ; }
+void    MCP_ADC::setGPIOpins(uint8_t, uint8_t, uint8_t, uint8_t) { ; }
+
+uint16_t (*esp32ReadHook)(int pin) = nullptr;
+
+void     ESP32AnalogRead::attach(int inPin) { pin = inPin; }
+uint16_t ESP32AnalogRead::readRaw()         { return esp32ReadHook ? esp32ReadHook(pin) : 0; }
+
+size_t fs::File::write(const uint8_t *buf, size_t len)
+{
+  if (!pData)
+  {
+    return 0;
+  }
+  pData->insert(pData->end(), buf, buf + len);
+  return len;
+}
+
+size_t fs::File::read(uint8_t *buf, size_t len)
+{
+  if (!pData)
+  {
+    return 0;
+  }
+  size_t n(std::min(len, pData->size() - pos));
+  memcpy(buf, pData->data() + pos, n);
+  pos += n;
+  return n;
+}
+
+size_t fs::File::size()
+{
+  return pData ? pData->size() : 0;
+}
+
+fs::File fs::FS::open(const char *path, const char *mode)
+{
+  if (mode[0] == 'w')
+  {
+    files[path].clear();
+    return File(&files[path]);
+  }
+
+  auto it(files.find(path));
+  return (it == files.end()) ? File() : File(&it->second);
+}
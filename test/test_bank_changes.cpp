@@ -0,0 +1,106 @@
+////////////////////////////////////////////////////////////////////////////////////////////
+//
+// ControllerBank change notification: switching scenes, morphing and importing all reach the
+// change callback and the take*() masks, not just changes made by service()
+//
+#include <ControllerBank.h>
+#include <TestHelpers.h>
+
+static const uint8_t CONTROLS(3);
+static const uint8_t MODES(2);
+static const uint8_t TOP(15);
+
+struct Notified
+{
+  int      calls;
+  uint32_t vals;
+  uint32_t locks;
+};
+
+static void onChange(uint32_t changedVals, uint32_t changedLocks, void *pArg)
+{
+  Notified *pSeen(static_cast<Notified *>(pArg));
+  ++pSeen->calls;
+  pSeen->vals  |= changedVals;
+  pSeen->locks |= changedLocks;
+}
+
+static uint16_t readHardware(int) { return 0; }
+
+int main()
+{
+  esp32ReadHook = readHardware;
+  uint8_t pins[CONTROLS] = {32, 33, 34};
+  ControllerBank bank(pins, CONTROLS, MODES, TOP);
+
+  // Mode 1 differs from mode 0 on controls 0 and 2 only
+  bank.selectScene(1, false);
+  bank.getPtr(0)->setLockVal(5);
+  bank.getPtr(2)->setLockVal(9);
+  bank.selectScene(0, false);
+  bank.service();
+  bank.takeChangedVals();
+  bank.takeChangedLocks();
+
+  Notified seen = {};
+  bank.setChangeCallback(onChange, &seen);
+
+  // A scene switch is reported straight away, from the task that made it...
+  bank.selectScene(1, false);
+  CHECK_EQ(seen.calls, 1);
+  CHECK_EQ(seen.vals, 0b101);
+  CHECK_EQ(bank.read(0), 5);
+  CHECK_EQ(bank.read(2), 9);
+
+  // ...and only once: nothing else has moved since
+  bank.readAll();
+  bank.service();
+  CHECK_EQ(seen.calls, 1);
+  CHECK_EQ(bank.takeChangedVals(), 0b101);
+  CHECK_EQ(bank.takeChangedVals(), 0);
+
+  // Back again, asking for pickup: the lock state goes to "waiting" on every control
+  seen = {};
+  bank.selectScene(0);
+  bank.takeChangedLocks();
+  CHECK_EQ(seen.calls, 1);
+  CHECK_EQ(seen.vals, 0b101);
+
+  // Morphing reports every step that moves something. The hardware is sitting on scene 0's
+  // values, so its controls were picked up straight away; the morph locks them.
+  seen = {};
+  bank.startMorph(0, 1);
+  CHECK_EQ(seen.calls, 1);
+  CHECK_EQ(seen.vals, 0);
+  CHECK_EQ(seen.locks, 0b111);
+
+  seen = {};
+  bank.setMorphPosition(MORPH_FULL);
+  CHECK_EQ(seen.calls, 1);
+  CHECK_EQ(seen.vals, 0b101);
+  CHECK_EQ(bank.read(0), 5);
+
+  seen = {};
+  bank.setMorphPosition(MORPH_FULL);
+  CHECK_EQ(seen.calls, 0);
+
+  bank.stopMorph();
+  CHECK_EQ(seen.calls, 1);
+  CHECK_EQ(seen.vals, 0b101);
+  CHECK_EQ(bank.read(0), 0);
+
+  // So does a scene import that changes the active mode's values
+  std::vector<uint8_t> buf(bank.sceneDataSize());
+  CHECK_EQ(bank.exportScenes(buf.data(), buf.size()), buf.size());
+  bank.selectScene(1, false);
+  bank.getPtr(1)->setLockVal(7);
+  bank.service();
+
+  seen = {};
+  CHECK(bank.importScenes(buf.data(), buf.size()));
+  CHECK_EQ(seen.calls, 1);
+  CHECK_EQ(seen.vals, 0b010);
+  CHECK_EQ(bank.read(1), 0);
+
+  return TEST_RESULT();
+}
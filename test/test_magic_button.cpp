@@ -0,0 +1,138 @@
+////////////////////////////////////////////////////////////////////////////////////////////
+//
+// MagicButton gestures: feed debounced up/down levels a millisecond at a time and check
+// which gesture gets reported, and when. Time starts just short of the millis() wrap so
+// every case also crosses it.
+//
+#include <MagicButton.h>
+#include <TestHelpers.h>
+#include <initializer_list>
+#include <utility>
+
+static const uint32_t START_TIME(0xFFFFFF00);
+static const int      RUN_MS(1200);
+
+struct Report
+{
+  ButtonState first;     // First non-Open state read()
+  int         firstMs;   // ...and when
+  int         lastMs;    // Last tick anything but Open was read
+  int         kinds;     // Number of distinct non-Open states seen
+};
+
+// edges: {ms, isDown} pairs, in order
+static Report run(bool doubleClickable,
+                  std::initializer_list<std::pair<int, bool>> edges,
+                  const ButtonTiming &timing = DEFAULT_BUTTON_TIMING)
+{
+  MagicButton button(-1, false, doubleClickable);
+  button.setTiming(timing);
+
+  Report report{Open, -1, -1, 0};
+  uint32_t seen(0);
+  auto edge(edges.begin());
+  bool down(false);
+  for (int ms(0); ms < RUN_MS; ++ms)
+  {
+    if ((edge != edges.end()) && (edge->first == ms))
+    {
+      down = edge->second;
+      ++edge;
+    }
+
+    button.serviceDebounced(down, START_TIME + ms);
+    ButtonState state(button.read());
+    if (state == Open)
+    {
+      continue;
+    }
+
+    if (report.firstMs < 0)
+    {
+      report.first   = state;
+      report.firstMs = ms;
+    }
+    report.lastMs = ms;
+    if (!(seen & (1 << state)))
+    {
+      seen |= (1 << state);
+      ++report.kinds;
+    }
+  }
+
+  return report;
+}
+
+int main()
+{
+  // Click: reported once the double-click window after the release runs out
+  Report r(run(true, {{10, true}, {60, false}}));
+  CHECK_EQ(r.first, Clicked);
+  CHECK_EQ(r.firstMs, 60 + DOUBLECLICKTIME);
+  CHECK_EQ(r.kinds, 1);
+
+  // Without double-clicks there's nothing to wait for
+  r = run(false, {{10, true}, {60, false}});
+  CHECK_EQ(r.first, Clicked);
+  CHECK_EQ(r.firstMs, 61);
+  CHECK_EQ(r.kinds, 1);
+
+  // Double-click: the second click has to start inside the window
+  r = run(true, {{10, true}, {60, false}, {100, true}, {130, false}});
+  CHECK_EQ(r.first, DoubleClicked);
+  CHECK_EQ(r.firstMs, 130 + DOUBLECLICKTIME);
+  CHECK_EQ(r.kinds, 1);
+
+  // Two clicks too far apart are two clicks
+  r = run(true, {{10, true}, {60, false}, {60 + DOUBLECLICKTIME + 20, true}, {60 + DOUBLECLICKTIME + 60, false}});
+  CHECK_EQ(r.first, Clicked);
+  CHECK_EQ(r.firstMs, 60 + DOUBLECLICKTIME);
+  CHECK_EQ(r.kinds, 1);
+
+  // Pressed: down longer than PRESSTIME but let go before HOLDTIME; reported on release
+  r = run(true, {{10, true}, {10 + PRESSTIME + 40, false}});
+  CHECK_EQ(r.first, Pressed);
+  CHECK_EQ(r.firstMs, 10 + PRESSTIME + 40);
+  CHECK_EQ(r.kinds, 1);
+
+  // Held: HOLDTIME after the press, for as long as it stays down, and nothing after
+  r = run(true, {{10, true}, {600, false}});
+  CHECK_EQ(r.first, Held);
+  CHECK_EQ(r.firstMs, 10 + HOLDTIME);
+  CHECK_EQ(r.lastMs, 600);
+  CHECK_EQ(r.kinds, 1);
+
+  // Click-and-hold: click, then press and keep holding past the double-click window
+  r = run(true, {{10, true}, {60, false}, {100, true}, {600, false}});
+  CHECK_EQ(r.first, ClickedAndHeld);
+  CHECK_EQ(r.firstMs, 100 + DOUBLECLICKTIME);
+  CHECK_EQ(r.lastMs, 600);
+  CHECK_EQ(r.kinds, 1);
+
+  // Per-button timing
+  ButtonTiming quick{50, 100, 200};
+  r = run(true, {{10, true}, {20, false}}, quick);
+  CHECK_EQ(r.first, Clicked);
+  CHECK_EQ(r.firstMs, 20 + quick.doubleClick);
+
+  r = run(true, {{10, true}, {500, false}}, quick);
+  CHECK_EQ(r.first, Held);
+  CHECK_EQ(r.firstMs, 10 + quick.hold);
+
+  // Gestures also go to an attached queue, stamped with the tick they were recognized on
+  ButtonEventQueue queue;
+  MagicButton button(-1, false, true);
+  button.attachEventQueue(&queue, 7);
+  for (int ms(0); ms < 400; ++ms)
+  {
+    button.serviceDebounced((ms >= 10) && (ms < 60), START_TIME + ms);
+  }
+  ButtonEvent event;
+  CHECK(queue.pop(event));
+  CHECK_EQ(event.id, 7);
+  CHECK_EQ(event.gesture, Clicked);
+  CHECK_EQ(event.timestamp, START_TIME + 60 + DOUBLECLICKTIME);
+  CHECK(!queue.pop(event));
+
+  return TEST_RESULT();
+}
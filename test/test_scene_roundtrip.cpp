@@ -0,0 +1,155 @@
+////////////////////////////////////////////////////////////////////////////////////////////
+//
+// ControllerBank scene export / import: save a bank to a (stand-in) file, load it into a
+// fresh bank, and check every mode's value, lock state and range came across
+//
+#include <ControllerBank.h>
+#include <TestHelpers.h>
+
+static const uint8_t CONTROLS(3);
+static const uint8_t MODES(4);
+static const uint8_t TOP(15);
+static const uint8_t ACTIVE_MODE(2);
+
+static SceneRecord recordAt(const std::vector<uint8_t> &buf, uint8_t control, uint8_t mode)
+{
+  SceneRecord rec;
+  memcpy(&rec,
+         buf.data() + sizeof(SceneHeader) + ((size_t)control * MODES + mode) * sizeof(rec),
+         sizeof(rec));
+  return rec;
+}
+
+// Where the stub ADC says every control is sitting
+static uint16_t hardwarePosition(0);
+static uint16_t readHardware(int) { return hardwarePosition; }
+
+static std::vector<uint8_t> exportAll(ControllerBank &bank)
+{
+  std::vector<uint8_t> buf(bank.sceneDataSize());
+  CHECK_EQ(bank.exportScenes(buf.data(), buf.size()), buf.size());
+  return buf;
+}
+
+int main()
+{
+  esp32ReadHook = readHardware;
+  uint8_t pins[CONTROLS] = {32, 33, 34};
+  ControllerBank source(pins, CONTROLS, MODES, TOP);
+
+  // Different value and range for every control in every mode
+  for (uint8_t mode(0); mode < MODES; ++mode)
+  {
+    source.selectScene(mode, false);
+    for (uint8_t n(0); n < CONTROLS; ++n)
+    {
+      source.getPtr(n)->setMin(100 * mode + 10 * n);
+      source.getPtr(n)->setMax(4000 - 100 * mode - 10 * n);
+      source.getPtr(n)->setLockVal((mode * CONTROLS + n + 1) % (TOP + 1));
+    }
+  }
+
+  // Leave the active mode with control 0 picked up (the hardware is at 0), the rest waiting
+  source.selectScene(ACTIVE_MODE, false);
+  source.getPtr(0)->setLockVal(0);
+  source.selectScene(ACTIVE_MODE);
+  source.service();
+  source.service();
+  CHECK_EQ(source.getPtr(0)->getLockState(), STATE_UNLOCKED);
+  CHECK_EQ(source.getPtr(1)->getLockState(), STATE_UNLOCK_REQUESTED);
+
+  std::vector<uint8_t> saved(exportAll(source));
+
+  fs::FS flash;
+  CHECK(source.saveScenes(flash, "/scenes.bin"));
+
+  // Park the hardware above every stored value so nothing is picked up again on load
+  hardwarePosition = 4095;
+  ControllerBank restored(pins, CONTROLS, MODES, TOP);
+  restored.selectScene(ACTIVE_MODE);
+  for (uint8_t tick(0); tick < 100; ++tick)
+  {
+    restored.service();
+  }
+  CHECK(restored.loadScenes(flash, "/scenes.bin"));
+
+  std::vector<uint8_t> loaded(exportAll(restored));
+  for (uint8_t n(0); n < CONTROLS; ++n)
+  {
+    for (uint8_t mode(0); mode < MODES; ++mode)
+    {
+      SceneRecord want(recordAt(saved, n, mode));
+      SceneRecord got(recordAt(loaded, n, mode));
+
+      CHECK_EQ(got.lockVal,  want.lockVal);
+      CHECK_EQ(got.rangeMin, want.rangeMin);
+      CHECK_EQ(got.rangeMax, want.rangeMax);
+
+      // Inactive modes come back locked; an unlocked control has to be picked up again
+      LockState state((LockState)want.lockState);
+      if (mode != ACTIVE_MODE)
+      {
+        state = STATE_LOCKED;
+      }
+      else if (state == STATE_UNLOCKED)
+      {
+        state = STATE_UNLOCK_REQUESTED;
+      }
+      CHECK_EQ(got.lockState, state);
+    }
+  }
+
+  // The active mode reads the same through the normal accessors
+  for (uint8_t n(0); n < CONTROLS; ++n)
+  {
+    CHECK_EQ(restored.getPtr(n)->getMin(), source.getPtr(n)->getMin());
+    CHECK_EQ(restored.getPtr(n)->getMax(), source.getPtr(n)->getMax());
+  }
+
+  // A bank of a different shape, or a bad header, is turned away without changing anything
+  ControllerBank smaller(pins, CONTROLS - 1, MODES, TOP);
+  CHECK(!smaller.loadScenes(flash, "/scenes.bin"));
+  CHECK(!restored.loadScenes(flash, "/missing.bin"));
+
+  // So is a buffer with any corrupt record in it, even one near the end: nothing before it
+  // gets applied either
+  auto corrupted([&](void (*corrupt)(SceneRecord &)) {
+    std::vector<uint8_t> buf(saved);
+    for (uint8_t mode(0); mode < MODES; ++mode)
+    {
+      SceneRecord rec(recordAt(buf, 0, mode));
+      rec.lockVal = 0;
+      memcpy(buf.data() + sizeof(SceneHeader) + mode * sizeof(rec), &rec, sizeof(rec));
+    }
+
+    SceneRecord rec(recordAt(buf, CONTROLS - 1, MODES - 1));
+    corrupt(rec);
+    memcpy(buf.data() + sizeof(SceneHeader) + ((CONTROLS - 1) * MODES + MODES - 1) * sizeof(rec),
+           &rec, sizeof(rec));
+    return buf;
+  });
+
+  std::vector<uint8_t> bad(corrupted([](SceneRecord &rec) { rec.rangeMin = rec.rangeMax + 1; }));
+  CHECK(!restored.importScenes(bad.data(), bad.size()));
+  CHECK(exportAll(restored) == loaded);
+
+  bad = corrupted([](SceneRecord &rec) { rec.lockVal = TOP + 1; });
+  CHECK(!restored.importScenes(bad.data(), bad.size()));
+  CHECK(exportAll(restored) == loaded);
+
+  bad = corrupted([](SceneRecord &rec) { rec.lockState = STATE_LOCKED + 1; });
+  CHECK(!restored.importScenes(bad.data(), bad.size()));
+  CHECK(exportAll(restored) == loaded);
+
+  // (The same edits that leave the record valid do load)
+  bad = corrupted([](SceneRecord &rec) { rec.lockVal = TOP; });
+  CHECK(restored.importScenes(bad.data(), bad.size()));
+  CHECK(exportAll(restored) != loaded);
+
+  saved[4] = SCENE_VERSION + 1;
+  std::vector<uint8_t> before(exportAll(restored));
+  CHECK(!restored.importScenes(saved.data(), saved.size()));
+  CHECK(exportAll(restored) == before);
+
+  return TEST_RESULT();
+}
@@ -0,0 +1,105 @@
+////////////////////////////////////////////////////////////////////////////////////////////
+//
+// HardwareCtrl under contention: two threads call service() on one control (as both cores
+// might) while a third reads it. runningSum is the window's checksum: it has to equal the
+// sum of buff[] whenever the window lock is free, so the reader keeps taking the lock and
+// comparing the two while the writers run. A torn update (or a stale sum left behind by a
+// lost one) shows up as a mismatch there, and again in the final check once they stop.
+//
+#include <SharedCtrl.h>
+#include <TestHelpers.h>
+#include <thread>
+
+static const int16_t SAMPLE_LO(1000);
+static const int16_t SAMPLE_HI(3000);
+static const int     ITERATIONS(2000000);
+
+static std::atomic<uint32_t> sampleCount(0);
+
+static int16_t nextSample(uint8_t)
+{
+  return SAMPLE_LO + (int16_t)(sampleCount.fetch_add(1) % (SAMPLE_HI - SAMPLE_LO + 1));
+}
+
+// Exposes the window for the final consistency check
+struct TestCtrl : public HardwareCtrl
+{
+  using HardwareCtrl::HardwareCtrl;
+
+  bool windowAddsUp()
+  {
+    int32_t sum(0);
+    for (uint8_t ii = 0; ii < buffSize; ++ii)
+    {
+      sum += buff[ii];
+    }
+    return (sum == runningSum) && (read() == int16_t(runningSum / buffSize));
+  }
+
+  // Same, mid-run: as a consistent reader would, under the window lock. The published
+  // mean is left out, since a writer may be just past the lock and about to store it.
+  bool windowAddsUpNow()
+  {
+    portENTER_CRITICAL(&windowLock);
+    int32_t sum(0);
+    for (uint8_t ii = 0; ii < buffSize; ++ii)
+    {
+      sum += buff[ii];
+    }
+    bool ok(sum == runningSum);
+    portEXIT_CRITICAL(&windowLock);
+    return ok;
+  }
+};
+
+int main()
+{
+  mcpReadHook = nextSample;
+  TestCtrl ctrl(std::make_shared<MCP3208>(), 0, 16);
+  CHECK(ctrl.isReady());
+
+  std::atomic<bool> done(false);
+  auto writer = [&ctrl]()
+  {
+    for (int n = 0; n < ITERATIONS; ++n)
+    {
+      ctrl.service();
+    }
+  };
+
+  uint32_t reads(0);
+  uint32_t badReads(0);
+  uint32_t tornWindows(0);
+  std::thread reader([&]()
+  {
+    while (!done.load())
+    {
+      int16_t mean(ctrl.read());
+      ++reads;
+      if ((mean < SAMPLE_LO) || (mean > SAMPLE_HI))
+      {
+        ++badReads;
+      }
+
+      if (!ctrl.windowAddsUpNow())
+      {
+        ++tornWindows;
+      }
+    }
+  });
+
+  std::thread writerA(writer);
+  std::thread writerB(writer);
+  writerA.join();
+  writerB.join();
+  done.store(true);
+  reader.join();
+
+  printf("  %u reads during %d services\n", reads, 2 * ITERATIONS);
+  CHECK(reads > 0);
+  CHECK_EQ(badReads, 0);
+  CHECK_EQ(tornWindows, 0);
+  CHECK(ctrl.windowAddsUp());
+
+  return TEST_RESULT();
+}